@@ -13,6 +13,9 @@ extern "C" {
 #include "winpriv.h"  /* win_prefix_title, win_update_now */
 #include "tek.h"      /* tek_mode for log filtering */
 #include "appinfo.h"  /* APPNAME, VERSION */
+#include "childpool.h"
+#include "phases.h"
+#include "record.h"
 
 #include <pwd.h>
 #include <fcntl.h>
@@ -21,6 +24,7 @@ extern "C" {
 #include <signal.h>
 #include <sys/ioctl.h>
 #include <sys/wait.h>
+#include <pthread.h>
 #ifdef __CYGWIN__
 #include <sys/cygwin.h>  // cygwin_internal
 #endif
@@ -227,164 +231,372 @@ printline(char * tag, char * s, int len)
 #define printline(tag, s, len)	
 #endif
 
-void
-(term_log)(struct term* term_p, char * s, uint len)
+/*
+   Log output is appended to a ring buffer which a background thread 
+   writes to the log file, so that logging does not cost the terminal 
+   a write() per chunk or per escape sequence.
+ */
+#define LOGRING_SIZE (1 << 20)  // power of 2, so free-running indexes wrap
+static char * logring = 0;
+static uint log_head = 0, log_tail = 0;
+static bool log_writer_running = false;
+// process owning the writer thread; forked children do not inherit it
+static pid_t log_writer_pid = 0;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_avail = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t log_drained = PTHREAD_COND_INITIALIZER;
+
+static void *
+log_writer(void * unused(arg))
 {
-static char buf[999];
-static uint bufi = 0;
-static char state = 0;
+  pthread_mutex_lock(&log_mutex);
+  for (;;) {
+    while (log_head == log_tail)
+      pthread_cond_wait(&log_avail, &log_mutex);
+    uint pos = log_tail % LOGRING_SIZE;
+    uint len = min(log_head - log_tail, LOGRING_SIZE - pos);
+    int fd = log_fd;
+    pthread_mutex_unlock(&log_mutex);
+
+    int n = fd >= 0 ? write(fd, logring + pos, len) : (int)len;
+    if (n < 0 && errno == EINTR)
+      n = 0;
+    else if (n <= 0)
+      n = len;  // drop data on write error rather than spinning
+
+    pthread_mutex_lock(&log_mutex);
+    log_tail += n;
+    pthread_cond_broadcast(&log_drained);
+  }
+  return 0;
+}
 
-  TERM_VAR_REF(true)
+// in a forked child, there is no writer thread, and the mutex may have 
+// been held by another thread at fork time; start over without the ring
+static void
+log_atfork_child(void)
+{
+  pthread_mutex_init(&log_mutex, 0);
+  pthread_cond_init(&log_avail, 0);
+  pthread_cond_init(&log_drained, 0);
+  log_writer_running = false;
+  log_head = log_tail = 0;
+  logring = 0;
+}
 
-  printline("log", s, len);
+static void
+log_drain(void)
+{
+  // only the writer's process waits for it (atexit is inherited by fork)
+  if (getpid() != log_writer_pid)
+    return;
+  pthread_mutex_lock(&log_mutex);
+  while (log_writer_running && log_head != log_tail)
+    pthread_cond_wait(&log_drained, &log_mutex);
+  pthread_mutex_unlock(&log_mutex);
+}
 
-  auto term_log_flush = [&]()
-  {
-    printline("log-flush", buf, bufi);
-    write(log_fd, buf, bufi);
-    bufi = 0;
-  };
+static void
+log_append(const char * s, uint len)
+{
+  if (!len)
+    return;
+
+  pthread_mutex_lock(&log_mutex);
+  if (!log_writer_running) {
+    pthread_t thread;
+    logring = newn(char, LOGRING_SIZE);
+    if (logring && pthread_create(&thread, 0, log_writer, 0) == 0) {
+      pthread_detach(thread);
+      log_writer_running = true;
+      if (!log_writer_pid) {
+        atexit(log_drain);
+        pthread_atfork(0, 0, log_atfork_child);
+      }
+      log_writer_pid = getpid();
+    }
+    else {
+      // fall back to synchronous logging
+      free(logring);
+      logring = 0;
+      pthread_mutex_unlock(&log_mutex);
+      write(log_fd, s, len);
+      return;
+    }
+  }
+  while (len) {
+    uint space = LOGRING_SIZE - (log_head - log_tail);
+    if (!space) {
+      // writer is behind by a whole buffer; wait rather than lose data
+      pthread_cond_wait(&log_drained, &log_mutex);
+      continue;
+    }
+    uint pos = log_head % LOGRING_SIZE;
+    uint n = min(min(len, space), LOGRING_SIZE - pos);
+    memcpy(logring + pos, s, n);
+    log_head += n;
+    s += n;
+    len -= n;
+    pthread_cond_signal(&log_avail);
+  }
+  pthread_mutex_unlock(&log_mutex);
+}
 
-  auto term_log_char = [&](struct term* term_p, char c)
-  {
-    TERM_VAR_REF(true)
+/*
+   Log filter: a streaming scanner which holds back each escape sequence 
+   until its terminator, tracking the parameters needed to classify it 
+   on the fly; sequences that would request or enable terminal reports 
+   are dropped, everything else is passed to the log.
+   Strings longer than the hold buffer cannot be queries and are passed 
+   through in bulk.
+ */
+enum { LS_GROUND, LS_ESC, LS_CSI, LS_STR, LS_STR_ESC };
+
+static void
+log_seq_start(term_log_scanner * ls)
+{
+  memset(ls, 0, offsetof(term_log_scanner, seq));
+  ls->state = LS_ESC;
+  ls->seq[0] = '\e';
+  ls->seqlen = 1;
+}
+
+static void
+log_seq_add(term_log_scanner * ls, const char * s, uint len)
+{
+  if (!ls->pass && ls->seqlen + len > sizeof ls->seq) {
+    log_append(ls->seq, ls->seqlen);
+    ls->seqlen = 0;
+    ls->pass = true;
+  }
+  if (ls->pass)
+    log_append(s, len);
+  else {
+    memcpy(ls->seq + ls->seqlen, s, len);
+    ls->seqlen += len;
+  }
+}
+
+static void
+log_seq_end(term_log_scanner * ls, bool query)
+{
+  if (query && !ls->pass)
+    printline("log-filter", ls->seq, ls->seqlen);
+  else
+    log_append(ls->seq, ls->seqlen);
+  ls->seqlen = 0;
+  ls->pass = false;
+  ls->state = LS_GROUND;
+}
+
+static bool
+log_csi_query(term_log_scanner * ls, uchar c2)
+{
+  uchar c0 = ls->prefix, c1 = ls->last;
+  uint num = ls->num[0], num2 = ls->num[1];
+  return (c2 == 'n' && (!c0 || c0 == '?'))
+      || (c2 == 'c' && !num && (!c0 || c0 == '>' || c0 == '='))
+      || (c2 == 'q' && c0 == '>' && !num)
+      || (c2 == 't' && !c0 && num >= 11 && num <= 21)
+      || (c2 == 'p' && c1 == '$' && (!c0 || c0 == '?'))
+      || (c2 == 'y' && c1 == '*' && !c0)
+      || (c2 == 'v' && c1 == '"' && !c0)
+      || (c2 == 'R' && c1 == '#' && !c0)
+      || (c2 == 'x' && !c0 && num <= 1)
+      || (c2 == 'w' && c1 == '$' && !c0)
+      || (c2 == 'm' && c0 == '?')
+      || (c2 == 'h' && c0 == '?' &&
+          (num == 9 || (num >= 1000 && num <= 1004) || num == 1007
+           || num == 7786 || num == 7787
+          )
+         )
+      || (c2 == 'w' && c1 == '\'' && !c0)
+      || (c2 == 'z' && c1 == '\'' && !c0)
+      || (c2 == '|' && c1 == '\'' && !c0)
+      || (c2 == 'S' && c1 == '#' && !c0)
+      || (c2 == '|' && c1 == '#' && !c0)
+      || (c2 == 'S' && c0 == '?' && (num2 == 1 || num2 == 4))
+      ;
+}
+
+static bool
+log_str_query(term_log_scanner * ls)
+{
+  if (ls->strtype == 'd')
+    return (ls->d0 == '$' && ls->d1 == 'q')
+        || (ls->d0 == '+' && (ls->d1 == 'q' || ls->d1 == 'Q'));
+
+  int num = ls->num_ok ? (int)ls->num[0] : -1;
+  if (ls->q2 && ((ls->num1_ok && (num == 4 || num == 5 || num == 7704))
+                 || num == 52))
+    return true;
+  if (ls->q1 && ((num >= 10 && num <= 19) || num == 50 || num == 52
+                 || num == 701 || num == 7770 || num == 7771 || num == 7777))
+    return true;
+  return num == 60 || num == 61 || num == 62;
+}
+
+static void
+log_num(uint * num, bool * ok, bool first, char c)
+{
+  if (isdigit((uchar)c) && (first || *ok)) {
+    *ok = true;
+    if (*num < 100000)
+      *num = *num * 10 + c - '0';
+  }
+  else
+    *ok = false;
+}
 
-    if (bufi >= sizeof(buf)) {
-      term_log_flush();
-      state = 0;
+static void
+log_scan_char(term_log_scanner * ls, char c)
+{
+  if (ls->state == LS_STR_ESC) {
+    if (c == '\\') {
+      log_seq_add(ls, "\e\\", 2);
+      log_seq_end(ls, log_str_query(ls));
     }
-    else if (c == '\e' && !state)
-      term_log_flush();
     else {
-      printline("not-flush", buf, bufi);
+      // string aborted by another escape sequence
+      log_seq_add(ls, "\e", 1);
+      log_seq_end(ls, false);
+      log_seq_start(ls);
+      log_scan_char(ls, c);
     }
+    return;
+  }
+  if (c == '\e') {
+    if (ls->state == LS_STR)
+      ls->state = LS_STR_ESC;
+    else {
+      // sequence aborted by another escape sequence
+      log_seq_end(ls, false);
+      log_seq_start(ls);
+    }
+    return;
+  }
 
-    buf[bufi++] = c;
-
-    if (term.vt52_mode || tek_mode)
-      return;
+  log_seq_add(ls, &c, 1);
 
-    if (!state) {
-      if (c == '') {
-        bufi--;
-        state = 0;
-      }
-      else if (c == '\e')
-        state = 'e';
+  if (ls->state == LS_ESC) {
+    if (c == '[') {
+      ls->state = LS_CSI;
+      ls->last = c;
     }
-    else if (state == 'e') {
-      if (c == '[')
-        state = 'c';
-      else if (c == ']')
-        state = 'o';
-      else if (c == 'P')
-        state = 'd';
-      else if (c == 'Z') {
-        bufi = 0;
-        state = 0;
-      }
+    else if (c == ']' || c == 'P') {
+      ls->state = LS_STR;
+      ls->strtype = c == ']' ? 'o' : 'd';
     }
-    else if (state == 'c') { // CSI (ESC [)
-      if (c >= '@') { // CSI terminator
-        state = 0;
-        char * csi = &buf[2];
-        char c0 = *csi, c1 = buf[bufi - 2], c2 = buf[bufi - 1];
-        if (c0 >= '0' && c0 <= ';')
-          c0 = 0;
-        else
-          csi ++;
-        int num = 0, num2 = 0;
-        sscanf(csi, "%u;%u", &num, &num2);
-        sscanf(csi, "%u", &num);
-        if ((c2 == 'n' && (!c0 || c0 == '?'))
-            || (c2 == 'c' && !num && (!c0 || c0 == '>' || c0 == '='))
-            || (c2 == 'q' && c0 == '>' && !num)
-            || (c2 == 't' && !c0 && num >= 11 && num <= 21)
-            || (c2 == 'p' && c1 == '$' && (!c0 || c0 == '?'))
-            || (c2 == 'y' && c1 == '*' && !c0)
-            || (c2 == 'v' && c1 == '"' && !c0)
-            || (c2 == 'R' && c1 == '#' && !c0)
-            || (c2 == 'x' && !c0 && num <= 1)
-            || (c2 == 'w' && c1 == '$' && !c0)
-            || (c2 == 'm' && c0 == '?')
-            || (c2 == 'h' && c0 == '?' &&
-                (num == 9 || (num >= 1000 && num <= 1004) || num == 1007
-                 || num == 7786 || num == 7787
-                )
-               )
-            || (c2 == 'w' && c1 == '\'' && !c0)
-            || (c2 == 'z' && c1 == '\'' && !c0)
-            || (c2 == '|' && c1 == '\'' && !c0)
-            || (c2 == 'S' && c1 == '#' && !c0)
-            || (c2 == '|' && c1 == '#' && !c0)
-            || (c2 == 'S' && c0 == '?' && (num2 == 1 || num2 == 4))
-           )
-          bufi = 0;
-#ifdef debug_log_filter
-        if (!bufi)
-          printf("log filter CSI %c %d %d %c %c\n", c0 ?: '-', num, num2, c1, c2);
-#endif
+    else if (c == 'Z')  // DECID
+      log_seq_end(ls, true);
+    else if (c < 0x20 || c >= 0x30)
+      log_seq_end(ls, false);
+    // else intermediate character, stay in ESC state
+  }
+  else if (ls->state == LS_CSI) {
+    if ((uchar)c >= '@')
+      log_seq_end(ls, log_csi_query(ls, c));
+    else {
+      if (ls->last == '[' && (c < '0' || c > ';'))
+        ls->prefix = c;
+      else if (isdigit((uchar)c)) {
+        if (ls->field < 2 && ls->num[ls->field] < 100000)
+          ls->num[ls->field] = ls->num[ls->field] * 10 + c - '0';
       }
-    }
-    else if (state == 'o') { // OSC (ESC ])
-      if (c == '' || (c == '\\' && buf[bufi - 1] == '\e')) { // ST or BEL
-        state = 0;
-        int num = -1, numq1 = -1, numq2 = -1;
-        int slen = 0;
-        if (2 == sscanf(&buf[2], "%u;%u;%n", &num, &numq2, &slen)) {
-          if (buf[2 + slen] != '?')
-            numq2 = -1;
-        }
-        else {
-          sscanf(&buf[2], "%u;%n", &num, &slen);
-          if (buf[2 + slen] == '?')
-            numq1 = num;
-        }
-#ifdef debug_log_filter
-        int bufend = bufi;
-#endif
-        if (numq2 == 4 || numq2 == 7704 || numq2 == 5)
-          bufi = 0;
-        else if ((numq1 >= 10 && numq1 <= 19) || numq1 == 50 || numq1 == 52
-                 || numq1 == 701 || numq1 == 7770 || numq1 == 7771 || numq1 == 7777
-                )
-          bufi = 0;
-        else if (num == 60 || num == 61 || num == 62)
-          bufi = 0;
-#ifdef debug_log_filter
-        if (!bufi) {
-          buf[bufend] = 0;
-          printf("log filter OSC %d %d %d (\\e%s)\n", num, numq1, numq2, &buf[1]);
-        }
-#endif
+      else if (c == ';') {
+        if (ls->field < 2)
+          ls->field++;
       }
+      else if (c == ':')
+        ls->field = 2;
+      ls->last = c;
     }
-    else if (state == 'd') { // DCS (ESC P)
-      if (c == '\\' && buf[bufi - 1] == '\e') { // ST
-        state = 0;
-        if (!strncmp(&buf[2], "$q", 2) || !strncasecmp(&buf[2], "+q", 2))
-          bufi = 0;
-      }
+  }
+  else if (ls->state == LS_STR) {
+    if (c == '\a' && ls->strtype == 'o')
+      log_seq_end(ls, log_str_query(ls));
+    else if (ls->strtype == 'd') {
+      if (ls->fieldpos == 0)
+        ls->d0 = c;
+      else if (ls->fieldpos == 1)
+        ls->d1 = c;
+      if (ls->fieldpos < 2)
+        ls->fieldpos++;
+    }
+    else if (c == ';') {
+      if (ls->field < 3)
+        ls->field++;
+      ls->fieldpos = 0;
     }
-  };
-
-  if (log_fd >= 0 && logging) {
-    if (!cfg.log_filter)
-      write(log_fd, s, len);
     else {
-      for (uint i = 0; i < len; i++)
-        term_log_char(term_p, s[i]);
+      if (ls->field == 0)
+        log_num(&ls->num[0], &ls->num_ok, !ls->fieldpos, c);
+      else if (ls->field == 1) {
+        if (!ls->fieldpos && c == '?')
+          ls->q1 = true;
+        log_num(&ls->num[1], &ls->num1_ok, !ls->fieldpos, c);
+      }
+      else if (ls->field == 2 && !ls->fieldpos && c == '?')
+        ls->q2 = true;
+      if (ls->fieldpos < 255)
+        ls->fieldpos++;
     }
   }
 }
 
 void
-(child_close_log)(struct term* term_p)
+(term_log)(struct term* term_p, char * s, uint len)
 {
   TERM_VAR_REF(true)
 
-  char buf = '\e';
-  term_log(&buf, 1);  // trigger term_log_flush();
+  printline("log", s, len);
+
+  if (log_fd < 0 || !logging)
+    return;
+
+  term_log_scanner * ls = &term.log_scan;
+  if (!cfg.log_filter || term.vt52_mode || tek_mode) {
+    if (ls->state != LS_GROUND)
+      log_seq_end(ls, false);
+    log_append(s, len);
+    return;
+  }
+
+  uint i = 0;
+  while (i < len) {
+    if (ls->state == LS_GROUND) {
+      // pass plain text in bulk
+      uint j = i;
+      while (j < len && s[j] != '\e' && s[j] != '\005')
+        j++;
+      log_append(s + i, j - i);
+      if (j < len && s[j] == '\e')
+        log_seq_start(ls);
+      // else drop ENQ (answerback request)
+      i = j + 1;
+    }
+    else if (ls->state == LS_STR && ls->pass) {
+      // pass long string contents in bulk
+      uint j = i;
+      while (j < len && s[j] != '\e' && s[j] != '\a')
+        j++;
+      log_append(s + i, j - i);
+      i = j;
+      if (i < len)
+        log_scan_char(ls, s[i++]);
+    }
+    else
+      log_scan_char(ls, s[i++]);
+  }
+}
+
+void
+(child_close_log)(struct term* term_p)
+{
+  // pass on a pending incomplete sequence and wait for the log writer
+  if (term_p && term_p->log_scan.state != LS_GROUND)
+    log_seq_end(&term_p->log_scan, false);
+  log_drain();
 }
 
 
@@ -482,6 +694,176 @@ ispathprefix(string pref, string path)
   return false;
 }
 
+/*
+   Set up the forked child process and invoke the command.
+ */
+static void
+child_exec(char * cmd, char * argv[], const char * path)
+{
+#if CYGWIN_VERSION_DLL_MAJOR < 1007
+  // Some native console programs require a console to be attached to the
+  // process, otherwise they pop one up themselves, which is rather annoying.
+  // Cygwin's exec function from 1.5 onwards automatically allocates a console
+  // on an invisible window station if necessary. Unfortunately that trick no
+  // longer works on Windows 7, which is why Cygwin 1.7 contains a new hack
+  // for creating the invisible console.
+  // On Cygwin versions before 1.5 and on Cygwin 1.5 running on Windows 7,
+  // we need to create the invisible console ourselves. The hack here is not
+  // as clever as Cygwin's, with the console briefly flashing up on startup,
+  // but it'll do.
+#if CYGWIN_VERSION_DLL_MAJOR == 1005
+  DWORD win_version = GetVersion();
+  win_version = ((win_version & 0xff) << 8) | ((win_version >> 8) & 0xff);
+  if (win_version >= 0x0601)  // Windows 7 is NT 6.1.
+#endif
+    if (AllocConsole()) {
+      HMODULE kernel = GetModuleHandleA("kernel32");
+      HWND (WINAPI *pGetConsoleWindow)(void) =
+        (void *)GetProcAddress(kernel, "GetConsoleWindow");
+      ShowWindowAsync(pGetConsoleWindow(), SW_HIDE);
+    }
+#endif
+
+  // Reset signals
+  signal(SIGHUP, SIG_DFL);
+  signal(SIGINT, SIG_DFL);
+  signal(SIGQUIT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGCHLD, SIG_DFL);
+
+  // Mimick login's behavior by disabling the job control signals
+  signal(SIGTSTP, SIG_IGN);
+  signal(SIGTTIN, SIG_IGN);
+  signal(SIGTTOU, SIG_IGN);
+
+  setenv("TERM", cfg.term, true);
+  // unreliable info about terminal application (#881)
+  setenv("TERM_PROGRAM", APPNAME, true);
+  setenv("TERM_PROGRAM_VERSION", VERSION, true);
+
+  // If option Locale is used, set locale variables?
+  // https://github.com/mintty/mintty/issues/116#issuecomment-108888265
+  // Variables are now set in update_locale() which sets one of 
+  // LC_ALL or LC_CTYPE depending on previous setting of 
+  // LC_ALL or LC_CTYPE or LANG, stripping @cjk modifiers for WSL.
+  if (cfg.old_locale) {
+    //string lang = cs_lang();
+    string lang = cs_lang() ? cs_get_locale() : 0;
+    if (lang) {
+      unsetenv("LC_ALL");
+      unsetenv("LC_COLLATE");
+      unsetenv("LC_CTYPE");
+      unsetenv("LC_MONETARY");
+      unsetenv("LC_NUMERIC");
+      unsetenv("LC_TIME");
+      unsetenv("LC_MESSAGES");
+      setenv("LANG", lang, true);
+    }
+  }
+
+  // Terminal line settings
+  struct termios attr;
+  tcgetattr(0, &attr);
+  attr.c_cc[VERASE] = cfg.backspace_sends_bs ? CTRL('H') : CDEL;
+  attr.c_iflag |= IXANY | IMAXBEL;
+#ifdef IUTF8
+  bool utf8 = strcmp(nl_langinfo(CODESET), "UTF-8") == 0;
+  if (utf8)
+    attr.c_iflag |= IUTF8;
+  else
+    attr.c_iflag &= ~IUTF8;
+#endif
+  attr.c_lflag |= ECHOE | ECHOK | ECHOCTL | ECHOKE;
+  tcsetattr(0, TCSANOW, &attr);
+
+  if (path)
+    chdir(path);
+
+  // Invoke command
+  execvp(cmd, argv);
+
+  // If we get here, exec failed.
+  fprintf(stderr, "\033]701;C.UTF-8\007");
+  fprintf(stderr, "\033[30;41m\033[K");
+  //__ %1$s: client command (e.g. shell) to be run; %2$s: error message
+  fprintf(stderr, _("Failed to run '%s': %s"), cmd, strerror(errno));
+  fprintf(stderr, "\r\n");
+  fflush(stderr);
+
+#if CYGWIN_VERSION_DLL_MAJOR < 1005
+  // Before Cygwin 1.5, the message above doesn't appear if we exit
+  // immediately. So have a little nap first.
+  usleep(200000);
+#endif
+
+  exit_fatty(mexit);
+}
+
+/*
+   Pool of ready children for new tabs (option TabPool); it is refilled 
+   with the command and directory of the next tab to be opened from the 
+   menu or by shortcut (win_tab_create); a ready child is only handed 
+   out for a tab with the same command, arguments and directory.
+ */
+static char * pool_cmd = 0;
+static char ** pool_argv = 0;
+static char * pool_dir = 0;
+static char * pool_key = 0;
+
+static char *
+pool_key_of(char * cmd, char * argv[], const char * dir)
+{
+  char * key = strdup(cmd);
+  for (int i = 0; argv[i]; i++) {
+    strappend(key, const_cast<char *>("\n"));
+    strappend(key, argv[i]);
+  }
+  // an unspecified directory is the current one
+  char * rp = realpath(dir ?: ".", 0);
+  strappend(key, const_cast<char *>("\n"));
+  strappend(key, rp ?: const_cast<char *>(dir ?: "."));
+  free(rp);
+  return key;
+}
+
+static void
+pool_exec(const char * dir)
+{
+  child_exec(pool_cmd, pool_argv, dir);
+}
+
+bool
+child_pool_refill(char * cmd, char * argv[], const char * dir, struct winsize * winp)
+{
+  if (cfg.tab_pool <= 0 || replaying || (support_wsl && wslname))
+    return false;
+
+  char * key = pool_key_of(cmd, argv, dir);
+  if (pool_key && !strcmp(key, pool_key))
+    free(key);
+  else {
+    // keep copies, as the caller's arguments may not live that long
+    free(pool_key);
+    pool_key = key;
+    free(pool_cmd);
+    pool_cmd = strdup(cmd);
+    for (int i = 0; pool_argv && pool_argv[i]; i++)
+      free(pool_argv[i]);
+    int argc = 0;
+    while (argv[argc])
+      argc++;
+    pool_argv = renewn(pool_argv, argc + 1);
+    for (int i = 0; i < argc; i++)
+      pool_argv[i] = strdup(argv[i]);
+    pool_argv[argc] = 0;
+    free(pool_dir);
+    pool_dir = dir ? strdup(dir) : 0;
+  }
+
+  trim_environment();
+  return childpool_fill(cfg.tab_pool, pool_key, pool_dir, winp, pool_exec);
+}
+
 void
 (child_create)(struct child* child_p, struct term* term_in,
     char *argv[], struct winsize *winp, const char* path)
@@ -498,6 +880,15 @@ void
 
   prev_winsize = *winp;
 
+  static uint record_ids = 0;
+  child_p->record_id = record_ids++;
+  record_resize(child_p->record_id, winp->ws_row, winp->ws_col);
+  if (replaying) {
+    // output comes from a recording (child_replay), there is no process
+    pid = 0;
+    return;
+  }
+
   // support OSC 7 directory cloning if cloning WSL window while in rootfs
   if (support_wsl && wslname) {
     // this is done once in a new window, so don't care about memory leaks
@@ -511,8 +902,19 @@ void
     }
   }
 
-  // Create the child process and pseudo terminal.
-  pid = forkpty(&pty_fd, 0, 0, winp);
+  // Take a ready child from the pool, handing over the actual size, 
+  // or create the child process and pseudo terminal.
+  struct winsize ready_winsize;
+  phase_begin("fork child");
+  char * key = childpool_size() ? pool_key_of(cmd, argv, path) : 0;
+  if (key && childpool_take(key, &pid, &pty_fd, &ready_winsize)) {
+    prev_winsize = ready_winsize;
+    child_resize(winp);
+  }
+  else
+    pid = forkpty(&pty_fd, 0, 0, winp);
+  free(key);
+  phase_end();
   if (pid < 0) {
     bool rebase_prompt = (errno == EAGAIN);
     //ENOENT  There are no available terminals.
@@ -527,105 +929,8 @@ void
 
     term_hide_cursor();
   }
-  else if (!pid) { // Child process.
-#if CYGWIN_VERSION_DLL_MAJOR < 1007
-    // Some native console programs require a console to be attached to the
-    // process, otherwise they pop one up themselves, which is rather annoying.
-    // Cygwin's exec function from 1.5 onwards automatically allocates a console
-    // on an invisible window station if necessary. Unfortunately that trick no
-    // longer works on Windows 7, which is why Cygwin 1.7 contains a new hack
-    // for creating the invisible console.
-    // On Cygwin versions before 1.5 and on Cygwin 1.5 running on Windows 7,
-    // we need to create the invisible console ourselves. The hack here is not
-    // as clever as Cygwin's, with the console briefly flashing up on startup,
-    // but it'll do.
-#if CYGWIN_VERSION_DLL_MAJOR == 1005
-    DWORD win_version = GetVersion();
-    win_version = ((win_version & 0xff) << 8) | ((win_version >> 8) & 0xff);
-    if (win_version >= 0x0601)  // Windows 7 is NT 6.1.
-#endif
-      if (AllocConsole()) {
-        HMODULE kernel = GetModuleHandleA("kernel32");
-        HWND (WINAPI *pGetConsoleWindow)(void) =
-          (void *)GetProcAddress(kernel, "GetConsoleWindow");
-        ShowWindowAsync(pGetConsoleWindow(), SW_HIDE);
-      }
-#endif
-
-    // Reset signals
-    signal(SIGHUP, SIG_DFL);
-    signal(SIGINT, SIG_DFL);
-    signal(SIGQUIT, SIG_DFL);
-    signal(SIGTERM, SIG_DFL);
-    signal(SIGCHLD, SIG_DFL);
-
-    // Mimick login's behavior by disabling the job control signals
-    signal(SIGTSTP, SIG_IGN);
-    signal(SIGTTIN, SIG_IGN);
-    signal(SIGTTOU, SIG_IGN);
-
-    setenv("TERM", cfg.term, true);
-    // unreliable info about terminal application (#881)
-    setenv("TERM_PROGRAM", APPNAME, true);
-    setenv("TERM_PROGRAM_VERSION", VERSION, true);
-
-    // If option Locale is used, set locale variables?
-    // https://github.com/mintty/mintty/issues/116#issuecomment-108888265
-    // Variables are now set in update_locale() which sets one of 
-    // LC_ALL or LC_CTYPE depending on previous setting of 
-    // LC_ALL or LC_CTYPE or LANG, stripping @cjk modifiers for WSL.
-    if (cfg.old_locale) {
-      //string lang = cs_lang();
-      string lang = cs_lang() ? cs_get_locale() : 0;
-      if (lang) {
-        unsetenv("LC_ALL");
-        unsetenv("LC_COLLATE");
-        unsetenv("LC_CTYPE");
-        unsetenv("LC_MONETARY");
-        unsetenv("LC_NUMERIC");
-        unsetenv("LC_TIME");
-        unsetenv("LC_MESSAGES");
-        setenv("LANG", lang, true);
-      }
-    }
-
-    // Terminal line settings
-    struct termios attr;
-    tcgetattr(0, &attr);
-    attr.c_cc[VERASE] = cfg.backspace_sends_bs ? CTRL('H') : CDEL;
-    attr.c_iflag |= IXANY | IMAXBEL;
-#ifdef IUTF8
-    bool utf8 = strcmp(nl_langinfo(CODESET), "UTF-8") == 0;
-    if (utf8)
-      attr.c_iflag |= IUTF8;
-    else
-      attr.c_iflag &= ~IUTF8;
-#endif
-    attr.c_lflag |= ECHOE | ECHOK | ECHOCTL | ECHOKE;
-    tcsetattr(0, TCSANOW, &attr);
-
-    if (path)
-      chdir(path);
-
-    // Invoke command
-    execvp(cmd, argv);
-
-    // If we get here, exec failed.
-    fprintf(stderr, "\033]701;C.UTF-8\007");
-    fprintf(stderr, "\033[30;41m\033[K");
-    //__ %1$s: client command (e.g. shell) to be run; %2$s: error message
-    fprintf(stderr, _("Failed to run '%s': %s"), cmd, strerror(errno));
-    fprintf(stderr, "\r\n");
-    fflush(stderr);
-
-#if CYGWIN_VERSION_DLL_MAJOR < 1005
-    // Before Cygwin 1.5, the message above doesn't appear if we exit
-    // immediately. So have a little nap first.
-    usleep(200000);
-#endif
-
-    exit_fatty(mexit);
-  }
+  else if (!pid) // Child process.
+    child_exec(cmd, argv, path);
   else { // Parent process.
     if (report_child_pid) {
       printf("%d\n", pid);
@@ -718,6 +1023,10 @@ child_free(struct child* child_p)
   if (pty_fd >= 0)
     close(pty_fd);
   pty_fd = -1;
+
+  free(child_p->outbuf);
+  child_p->outbuf = 0;
+  child_p->outbuf_pos = child_p->outbuf_len = child_p->outbuf_size = 0;
 }
 
 bool
@@ -889,18 +1198,96 @@ grandchild_process_list(void)
 }
 */
 
+/*
+  Output to the pty is non-blocking (see child_create); whatever the pty 
+  does not take immediately is appended to a per-child queue which is 
+  drained by child_flush when child_proc finds the pty writable.
+ */
+static void
+child_queue(struct child* child_p, const char *buf, uint len)
+{
+  if (child_p->outbuf_pos && child_p->outbuf_pos == child_p->outbuf_len)
+    child_p->outbuf_pos = child_p->outbuf_len = 0;
+  else if (child_p->outbuf_pos > child_p->outbuf_size / 2) {
+    // compact the queue
+    child_p->outbuf_len -= child_p->outbuf_pos;
+    memmove(child_p->outbuf, child_p->outbuf + child_p->outbuf_pos, 
+            child_p->outbuf_len);
+    child_p->outbuf_pos = 0;
+  }
+  if (child_p->outbuf_len + len > child_p->outbuf_size) {
+    uint size = max(4096, child_p->outbuf_size);
+    while (size < child_p->outbuf_len + len)
+      size *= 2;
+    child_p->outbuf = renewn(child_p->outbuf, size);
+    child_p->outbuf_size = size;
+  }
+  memcpy(child_p->outbuf + child_p->outbuf_len, buf, len);
+  child_p->outbuf_len += len;
+}
+
+uint
+(child_write_queued)(struct child* child_p)
+{
+  CHILD_VAR_REF(true)
+
+  return child_p->outbuf_len - child_p->outbuf_pos;
+}
+
+void
+(child_flush)(struct child* child_p)
+{
+  CHILD_VAR_REF(true)
+
+  while (child_p->outbuf_pos < child_p->outbuf_len) {
+    if (pty_fd < 0) {
+      child_p->outbuf_pos = child_p->outbuf_len = 0;
+      return;
+    }
+    int n = write(pty_fd, child_p->outbuf + child_p->outbuf_pos, 
+                          child_p->outbuf_len - child_p->outbuf_pos);
+    trace_line("cflu", n, child_p->outbuf + child_p->outbuf_pos, max(n, 0));
+    if (n > 0)
+      child_p->outbuf_pos += n;
+    else if (n < 0 && errno == EINTR)
+      continue;
+    else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      // pty is broken; drop pending output
+      child_p->outbuf_pos = child_p->outbuf_len = 0;
+      return;
+    }
+    else
+      return;
+  }
+}
+
 void
 (child_write)(struct child* child_p, const char *buf, uint len)
 {
   CHILD_VAR_REF(true)
 
-  if (pty_fd >= 0) {
-#ifdef debug_pty
-    int n =
-#endif
-    write(pty_fd, buf, len);
+  if (pty_fd < 0 || !len)
+    return;
+
+  record_data('i', child_p->record_id, buf, len);
+
+  // keep ordering: only write directly if nothing is pending
+  if (child_p->outbuf_pos == child_p->outbuf_len) {
+    int n;
+    do
+      n = write(pty_fd, buf, len);
+    while (n < 0 && errno == EINTR);
     trace_line("cwrt", n, buf, len);
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        return;
+      n = 0;
+    }
+    buf += n;
+    len -= n;
   }
+  if (len)
+    child_queue(child_p, buf, len);
 }
 
 /*
@@ -944,13 +1331,8 @@ void
     char *s;
     int len = vasprintf(&s, fmt, va);
     va_end(va);
-    if (len >= 0) {
-#ifdef debug_pty
-      int n =
-#endif
-      write(pty_fd, s, len);
-      trace_line("tprt", n, s, len);
-    }
+    if (len >= 0)
+      child_write(s, len);
     free(s);
   }
 }
@@ -983,6 +1365,7 @@ void
   if (pty_fd >= 0 && memcmp(&prev_winsize, winp, sizeof(struct winsize)) != 0) {
     prev_winsize = *winp;
     ioctl(pty_fd, TIOCSWINSZ, winp);
+    record_resize(child_p->record_id, winp->ws_row, winp->ws_col);
   }
 }
 
@@ -19,6 +19,16 @@ struct child
   pid_t pid = 0;
   int pty_fd = -1;
   struct term* term = NULL;
+
+  // pending output to the pty, drained by child_proc as it becomes writable
+  char *outbuf = NULL;
+  uint outbuf_pos = 0, outbuf_len = 0, outbuf_size = 0;
+
+  // token bucket for baud rate emulation (nanoseconds)
+  long long baud_time = 0, baud_credit = 0;
+
+  // identification of the tab in recordings (option --record)
+  uint record_id = 0;
 };
 
 #define CHILD_VAR_REF(check)                  \
@@ -38,6 +48,11 @@ extern void (childerror)(struct term* term_p, char * action, bool from_fork, int
 extern void (child_update_charset)(struct child * child_p);
 #define child_create(...) (child_create)(child_p, term_p, ##__VA_ARGS__)
 extern void (child_create)(struct child* child_p, struct term* term, char *argv[], struct winsize *winp, const char* path);
+// fork one ready child, returns true if more are to be forked
+extern bool child_pool_refill(char * cmd, char * argv[], const char * dir, struct winsize * winp);
+// output is replayed from a recording instead of running a child process
+extern bool replaying;
+extern void child_replay(bool max_speed);
 extern void open_logfile(bool toggling);
 extern void toggle_logging(void);
 #define term_log(...) (term_log)(term_p, ##__VA_ARGS__)
@@ -50,6 +65,10 @@ extern void child_terminate(struct child* child_p);
 //extern void child_kill(bool point_blank);
 #define child_write(...) (child_write)(child_p, ##__VA_ARGS__)
 extern void (child_write)(struct child* child_p, const char *, uint len);
+#define child_flush(...) (child_flush)(child_p, ##__VA_ARGS__)
+extern void (child_flush)(struct child* child_p);
+#define child_write_queued(...) (child_write_queued)(child_p, ##__VA_ARGS__)
+extern uint (child_write_queued)(struct child* child_p);
 #define child_break(...) (child_break)(child_p, ##__VA_ARGS__)
 extern void (child_break)(struct child* child_p);
 #define child_intr(...) (child_intr)(term_p, ##__VA_ARGS__)
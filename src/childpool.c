@@ -0,0 +1,184 @@
+// childpool.c (part of FaTTY)
+// Licensed under the terms of the GNU General Public License v3 or later.
+
+extern "C" {
+
+#include "childpool.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+
+#if CYGWIN_VERSION_API_MINOR >= 93
+#include <pty.h>
+#else
+int forkpty(int *, char *, struct termios *, struct winsize *);
+#endif
+
+#define POOL_MAX 16
+
+typedef struct {
+  pid_t pid;
+  int pty_fd;
+  struct winsize winsize;
+} pooled;
+
+static pooled pool[POOL_MAX];
+static uint pool_len = 0;
+static char * pool_key = 0;
+
+static bool
+same_key(const char * key)
+{
+  return pool_key && !strcmp(key, pool_key);
+}
+
+static void
+pool_remove(uint i)
+{
+  close(pool[i].pty_fd);
+  pool[i] = pool[--pool_len];
+}
+
+// drop children that have terminated while waiting
+static void
+pool_reap(void)
+{
+  for (uint i = 0; i < pool_len;) {
+    int status;
+    if (waitpid(pool[i].pid, &status, WNOHANG) == pool[i].pid)
+      pool_remove(i);
+    else
+      i++;
+  }
+}
+
+static void
+pool_discard(void)
+{
+  while (pool_len) {
+    pid_t pid = pool[pool_len - 1].pid;
+    kill(-pid, SIGKILL);
+    pool_remove(pool_len - 1);
+    waitpid(pid, 0, 0);
+  }
+}
+
+bool
+childpool_fill(uint n, const char * key, const char * dir, struct winsize * winp, childpool_exec_fn exec)
+{
+  pool_reap();
+  if (!same_key(key)) {
+    pool_discard();
+    free(pool_key);
+    pool_key = strdup(key);
+  }
+
+  if (n > POOL_MAX)
+    n = POOL_MAX;
+  // fork only one child per call, as fork may take a while
+  if (pool_len < n) {
+    pooled * p = &pool[pool_len];
+    p->winsize = *winp;
+    p->pid = forkpty(&p->pty_fd, 0, 0, winp);
+    if (p->pid < 0)
+      return false;
+    else if (!p->pid) {
+      exec(dir);
+      _exit(126);
+    }
+    pool_len++;
+  }
+  return pool_len < n;
+}
+
+bool
+childpool_take(const char * key, pid_t * pid, int * pty_fd, struct winsize * winp)
+{
+  pool_reap();
+  if (!pool_len || !same_key(key))
+    return false;
+
+  // hand out the oldest child, which has had the most time to start up
+  *pid = pool[0].pid;
+  *pty_fd = pool[0].pty_fd;
+  *winp = pool[0].winsize;
+  memmove(pool, pool + 1, --pool_len * sizeof(pooled));
+  return true;
+}
+
+uint
+childpool_size(void)
+{
+  return pool_len;
+}
+
+void
+childpool_clear(void)
+{
+  for (uint i = 0; i < pool_len; i++) {
+    kill(-pool[i].pid, SIGHUP);
+    close(pool[i].pty_fd);
+  }
+  pool_len = 0;
+}
+
+#ifdef CHILDPOOL_TEST
+
+static void
+test_exec(const char * dir)
+{
+  if (dir)
+    chdir(dir);
+  execl("/bin/sh", "sh", "-c", "read x; stty size; pwd", (char *)0);
+}
+
+int
+main()
+{
+  struct winsize spawn = {24, 80, 0, 0}, ws;
+  pid_t pid;
+  int fd;
+
+  bool ok = childpool_fill(3, "sh\n/tmp", "/tmp", &spawn, test_exec);
+  ok &= childpool_size() == 1;
+  while (childpool_fill(3, "sh\n/tmp", "/tmp", &spawn, test_exec))
+    ;
+  ok &= childpool_size() == 3;
+  ok &= !childpool_take("sh\n/", &pid, &fd, &ws);
+  ok &= !childpool_take("bash\n/tmp", &pid, &fd, &ws);
+  ok &= childpool_take("sh\n/tmp", &pid, &fd, &ws);
+  ok &= ws.ws_row == 24 && ws.ws_col == 80 && childpool_size() == 2;
+
+  // size handoff, as done by child_resize
+  struct winsize real = {30, 100, 0, 0};
+  ioctl(fd, TIOCSWINSZ, &real);
+  write(fd, "\n", 1);
+  char buf[256];
+  int len = 0, ret;
+  while (len < (int)sizeof buf - 1 && (ret = read(fd, buf + len, sizeof buf - 1 - len)) > 0)
+    len += ret;
+  buf[len] = 0;
+  waitpid(pid, 0, 0);
+  close(fd);
+  ok &= strstr(buf, "30 100") && strstr(buf, "/tmp");
+
+  // refill elsewhere discards the children waiting in /tmp
+  ok &= !childpool_fill(1, "sh\n/", "/", &spawn, test_exec);
+  ok &= childpool_size() == 1;
+  ok &= childpool_take("sh\n/", &pid, &fd, &ws) && !childpool_size();
+  close(fd);
+  kill(-pid, SIGKILL);
+  waitpid(pid, 0, 0);
+
+  childpool_fill(2, "sh\n.", 0, &spawn, test_exec);
+  childpool_fill(2, "sh\n.", 0, &spawn, test_exec);
+  childpool_clear();
+  ok &= !childpool_size();
+
+  printf("%s", buf);
+  return !ok;
+}
+
+#endif
+
+}
@@ -0,0 +1,31 @@
+#ifndef CHILDPOOL_H
+#define CHILDPOOL_H
+
+#include "std.h"
+
+#include <termios.h>
+#include <sys/ioctl.h>
+
+/*
+   Pool of pre-forked pty children, started ahead of time so that
+   a new tab does not have to wait for fork and exec; independent of
+   Windows. The pooled children are identified by a key, describing
+   their command and directory; a child is only handed out for a tab
+   to be started with the same key.
+ */
+
+// called in the forked child to run the command; must not return
+typedef void (*childpool_exec_fn)(const char * dir);
+
+// fork a child towards n ready with key, in dir (null: current
+// directory); ready children with another key are discarded;
+// returns true if more children are to be forked by further calls
+extern bool childpool_fill(uint n, const char * key, const char * dir, struct winsize * winp, childpool_exec_fn exec);
+// hand out a ready child with key, with the size it was started with
+extern bool childpool_take(const char * key, pid_t * pid, int * pty_fd, struct winsize * winp);
+// number of ready children
+extern uint childpool_size(void);
+// terminate all ready children
+extern void childpool_clear(void);
+
+#endif
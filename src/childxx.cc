@@ -3,6 +3,7 @@
 #include <cstdlib>
 #include <stdio.h>
 #include <algorithm>
+#include <map>
 
 #include <cygwin/version.h>
 #include <sys/cygwin.h>
@@ -21,6 +22,8 @@ int log_fd = -1;
 
 extern "C" {
 #include "child.h"
+#include "childpool.h"
+#include "record.h"
 #include "winpriv.h"
 extern void exit_fatty(int exit_val);
 
@@ -32,6 +35,7 @@ void child_onexit(int sig) {
         if (tab.chld->pid)
             kill(-tab.chld->pid, SIGHUP);
     }
+    childpool_clear();
     signal(sig, SIG_DFL);
     kill(getpid(), sig);
 }
@@ -59,6 +63,43 @@ void child_init() {
 
 #define patch_319
 
+#if CYGWIN_VERSION_API_MINOR >= 74
+static long long
+mono_ns(void)
+{
+  struct timespec tim;
+  clock_gettime(CLOCK_MONOTONIC, &tim);
+  return tim.tv_sec * 1000000000LL + tim.tv_nsec;
+}
+
+/*
+  Token bucket pacing for baud rate emulation: credit accumulates with 
+  elapsed time, each character consumes the time it takes to transmit.
+  Returns the number of bytes that may be read now, or 0 and the time 
+  until the next one is due, for which child_proc sets the select timeout.
+ */
+static uint
+baud_allowance(struct child* child_p, long long now, long long * wait)
+{
+  uint cps = std::max(1, child_p->term->baud / 10); // 1 start bit, 8 data bits, 1 stop bit
+  long long nspc = 1000000000LL / cps;
+  if (!child_p->baud_time)
+    child_p->baud_credit = nspc;
+  else
+    child_p->baud_credit += now - child_p->baud_time;
+  child_p->baud_time = now;
+  // limit bursts to 20ms worth of output
+  long long burst = std::max(nspc, 20000000LL);
+  if (child_p->baud_credit > burst)
+    child_p->baud_credit = burst;
+  if (child_p->baud_credit < nspc) {
+    *wait = nspc - child_p->baud_credit;
+    return 0;
+  }
+  return child_p->baud_credit / nspc;
+}
+#endif
+
 void child_proc() {
   win_tab_clean();
   if (win_tabs().size() == 0)
@@ -74,16 +115,36 @@ void child_proc() {
     }
 
     struct timeval timeout = {0, 100000}, *timeout_p = 0;
-    fd_set fds;
+#if CYGWIN_VERSION_API_MINOR >= 74
+    long long now = mono_ns();
+    long long baud_wait = -1;
+#endif
+    fd_set fds, wfds;
     FD_ZERO(&fds);
+    FD_ZERO(&wfds);
     FD_SET(win_fd, &fds);
     int highfd = win_fd;
     for (Tab& t : win_tabs()) {
+      // wait for writability of ptys with pending (queued) output
+      if (t.chld->pty_fd >= 0 && (child_write_queued)(t.chld.get())) {
+        FD_SET(t.chld->pty_fd, &wfds);
+        if (t.chld->pty_fd > highfd) highfd = t.chld->pty_fd;
+      }
       if (t.terminal->no_scroll)
         continue;
       if (t.chld->pty_fd > highfd) highfd = t.chld->pty_fd;
-      if (t.chld->pty_fd >= 0)
-        FD_SET(t.chld->pty_fd, &fds);
+      if (t.chld->pty_fd >= 0) {
+#if CYGWIN_VERSION_API_MINOR >= 74
+        long long wait;
+        if (t.terminal->baud > 0 && !baud_allowance(t.chld.get(), now, &wait)) {
+          // throttled: do not read before the next character is due
+          if (baud_wait < 0 || wait < baud_wait)
+            baud_wait = wait;
+        }
+        else
+#endif
+          FD_SET(t.chld->pty_fd, &fds);
+      }
 #ifndef patch_319
       else
 #endif
@@ -131,11 +192,22 @@ void child_proc() {
       }
     }
 
-    if (select(highfd + 1, &fds, 0, 0, timeout_p) > 0) {
+#if CYGWIN_VERSION_API_MINOR >= 74
+    if (baud_wait >= 0 && (!timeout_p || baud_wait < 100000000LL)) {
+      long long us = (baud_wait + 999) / 1000;
+      timeout.tv_sec = us / 1000000;
+      timeout.tv_usec = us % 1000000;
+      timeout_p = &timeout;
+    }
+#endif
+
+    if (select(highfd + 1, &fds, &wfds, 0, timeout_p) > 0) {
       for (Tab& t : win_tabs()) {
+        struct child* child_p = t.chld.get();
+        if (child_p->pty_fd >= 0 && FD_ISSET(child_p->pty_fd, &wfds))
+          (child_flush)(child_p);
         if (t.terminal->no_scroll)
           continue;
-        struct child* child_p = t.chld.get();
         if (child_p->pty_fd >= 0 && FD_ISSET(child_p->pty_fd, &fds)) {
           // Pty devices on old Cygwin versions (pre 1005) deliver only 4 bytes
           // at a time, and newer ones or MSYS2 deliver up to 256 at a time.
@@ -143,43 +215,19 @@ void child_proc() {
           // this avoids most partial updates, results in less flickering/tearing.
           static char buf[4096];
           uint len = 0;
+          bool paused = false;
 #if CYGWIN_VERSION_API_MINOR >= 74
           if (child_p->term->baud > 0) {
-            uint cps = child_p->term->baud / 10; // 1 start bit, 8 data bits, 1 stop bit
-            uint nspc = 2000000000 / cps;
-
-            static ulong prevtime = 0;
-            static ulong exceeded = 0;
-            static ulong granularity = 0;
-            struct timespec tim;
-            if (!granularity) {
-              clock_getres(CLOCK_MONOTONIC, &tim); // cygwin granularity: 539ns
-              granularity = tim.tv_nsec;
-            }
-            clock_gettime(CLOCK_MONOTONIC, &tim);
-            ulong now = tim.tv_sec * (long)1000000000 + tim.tv_nsec;
-            //printf("baud %d ns/char %d prev %ld now %ld delta\n", child_p->term->baud, nspc, prevtime, now);
-            if (now < prevtime + nspc) {
-              ulong delay = prevtime ? prevtime + nspc - now : 0;
-              if (delay < exceeded)
-                exceeded -= delay;
-              else {
-                tim.tv_sec = delay / 1000000000;
-                tim.tv_nsec = delay % 1000000000;
-                clock_nanosleep(CLOCK_MONOTONIC, 0, &tim, 0);
-                clock_gettime(CLOCK_MONOTONIC, &tim);
-                ulong then = tim.tv_sec * (long)1000000000 + tim.tv_nsec;
-                //printf("nsleep %ld -> %ld\n", delay, then - now);
-                if (then - now > delay)
-                  exceeded = then - now - delay;
-                now = then;
-              }
-            }
-            prevtime = now;
-
-            int ret = read(child_p->pty_fd, buf, 1);
-            if (ret > 0)
+            // read only as many bytes as the baud rate allows by now
+            long long wait;
+            uint n = baud_allowance(child_p, mono_ns(), &wait);
+            int ret = n ? read(child_p->pty_fd, buf, std::min(n, (uint)sizeof buf)) : 0;
+            if (ret > 0) {
               len = ret;
+              child_p->baud_credit -= ret * (1000000000LL / std::max(1, child_p->term->baud / 10));
+            }
+            else if (!n || (ret < 0 && errno == EAGAIN))
+              paused = true;
           }
           else
 #endif
@@ -193,8 +241,11 @@ void child_proc() {
               break;
           } while (len < sizeof buf);
 
-          if (len > 0) {
+          if (paused)
+            ;  // nothing due yet
+          else if (len > 0) {
             (term_write)(child_p->term, buf, len);
+            record_data('o', child_p->record_id, buf, len);
 //            trace_line("twrt", len, buf, len);
             // accelerate keyboard echo if (unechoed) keyboard input is pending
             if (kb_input) {
@@ -239,4 +290,70 @@ bool child_is_any_parent() {
     });
 }
 
+/*
+   Replay of a recording (option --replay): output is written to the tab 
+   it was recorded from, at its original pace or as fast as possible; 
+   recorded input is skipped as its echo is part of the output.
+   Finally, statistics and a digest of the terminal contents are 
+   reported to stdout, and we exit.
+ */
+bool replaying = false;
+static bool replay_max_speed;
+static ulong replay_start;
+static ulong replay_bytes = 0;
+static recitem replay_item;
+static bool replay_pending;
+static std::map<uint, struct term*> replay_terms;
+
+static struct term* replay_term(uint tab) {
+    auto it = replay_terms.find(tab);
+    if (it != replay_terms.end())
+      return it->second;
+    struct term* term_p = win_active_terminal();
+    if (!replay_terms.empty()) {
+      // recorded from another tab; replay tabs have no process, 
+      // so they are not cleaned up and the pointer stays valid
+      (win_tab_create)(term_p);
+      term_p = win_active_terminal();
+    }
+    replay_terms[tab] = term_p;
+    return term_p;
+}
+
+static void replay_step() {
+    // at maximum speed, yield every 50ms to let the display catch up
+    ulong slice_end = term_usec() + 50000;
+    while (replay_pending) {
+      ulong now = term_usec();
+      ulong due = replay_start + replay_item.usec;
+      if (replay_max_speed ? now > slice_end : now < due) {
+        win_callback(replay_max_speed ? 0 : (due - now) / 1000, replay_step);
+        return;
+      }
+      struct term* term_p = replay_term(replay_item.tab);
+      if (replay_item.kind == 'o') {
+        ulong t0 = term_usec();
+        (term_write)(term_p, replay_item.data, replay_item.len);
+        replay_sample(term_usec() - t0);
+        replay_bytes += replay_item.len;
+      }
+      else if (replay_item.kind == 'r')
+        (win_set_chars)(term_p, replay_item.rows, replay_item.cols);
+      replay_pending = replay_next(&replay_item);
+    }
+
+    unsigned long long digest = 0xCBF29CE484222325ull;
+    for (auto& t : replay_terms)
+      digest = (digest ^ (term_digest)(t.second)) * 0x100000001B3ull;
+    replay_report(stdout, replay_bytes, term_usec() - replay_start, digest);
+    exit_fatty(0);
+}
+
+void child_replay(bool max_speed) {
+    replay_max_speed = max_speed;
+    replay_start = term_usec();
+    replay_pending = replay_next(&replay_item);
+    win_callback(0, replay_step);
+}
+
 }
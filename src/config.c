@@ -25,6 +25,7 @@ extern "C" {
 
 #include <windows.h>  // registry handling
 #include "winpriv.h"  // support_wsl, load_library_func
+#include "phases.h"
 
 #include <termios.h>
 #ifdef __CYGWIN__
@@ -43,6 +44,8 @@ static char linebuf[444];
 
 wchar * config_log = 0;
 char * keyclick = 0;
+uint suppress_sgr_set[4];
+uint word_chars_set[0x800], word_chars_excl_set[0x800];
 
 
 // all entries need initialisation in options[] or crash...
@@ -85,6 +88,8 @@ const config default_cfg = {
   cursor_type : CUR_LINE,
   cursor_size : 0,
   cursor_blinks : true,
+  timer_slack : 16,
+  tab_pool : 0,
   config_themes : 1,
   // Text
   font : {name : W("Lucida Console"), size : 9, weight : 400, isbold : false},
@@ -188,6 +193,7 @@ const config default_cfg = {
   rewrap_on_resize : true,
   scrollback_lines : 10000,
   max_scrollback_lines : 250000,
+  max_scrollback_memory : 0,
   scrollbar : 1,
   scroll_mod : MDK_SHIFT,
   border_style : BORDER_NORMAL,
@@ -247,6 +253,7 @@ const config default_cfg = {
   filter_paste : "STTY",
   guard_path : 7,
   bracketed_paste_split : 0,
+  paste_queue_limit : 262144,
   suspbuf_max : 8080,
   printable_controls : 0,
   char_narrowing : 75,
@@ -412,6 +419,8 @@ options[] = {
   {"CursorType", OPT_CURSOR, offcfg(cursor_type)},
   {"CursorSize", OPT_CURSOR, offcfg(cursor_size)},
   {"CursorBlinks", OPT_BOOL, offcfg(cursor_blinks)},
+  {"TimerSlack", OPT_INT, offcfg(timer_slack)},
+  {"TabPool", OPT_INT, offcfg(tab_pool)},
   {"ConfigThemes", OPT_INT, offcfg(config_themes)},
 
   // Text
@@ -538,6 +547,7 @@ options[] = {
   {"RewrapOnResize", OPT_BOOL, offcfg(rewrap_on_resize)},
   {"ScrollbackLines", OPT_INT, offcfg(scrollback_lines)},
   {"MaxScrollbackLines", OPT_INT, offcfg(max_scrollback_lines)},
+  {"MaxScrollbackMemory", OPT_INT, offcfg(max_scrollback_memory)},
   {"Scrollbar", OPT_SCROLLBAR, offcfg(scrollbar)},
   {"ScrollMod", OPT_MOD, offcfg(scroll_mod)},
   {"BorderStyle", OPT_BORDER, offcfg(border_style)},
@@ -604,6 +614,7 @@ options[] = {
   {"FilterPasteControls", OPT_STRING, offcfg(filter_paste)},
   {"GuardNetworkPaths", OPT_INT, offcfg(guard_path)},
   {"BracketedPasteByLine", OPT_INT, offcfg(bracketed_paste_split)},
+  {"PasteQueueLimit", OPT_INT, offcfg(paste_queue_limit)},
   {"SuspendWhileSelecting", OPT_INT, offcfg(suspbuf_max)},
   {"PrintableControls", OPT_INT, offcfg(printable_controls)},
   {"CharNarrowing", OPT_INT, offcfg(char_narrowing)},
@@ -937,13 +948,42 @@ opterror(string msg, bool utf8params, string p1, string p2)
 }
 
 
+/*
+   Hash index into options by case-folded name, built on first use;
+   config files, themes and schemes look up every option they set.
+ */
+#define OPTINDEX_SIZE 1024  // power of 2, at least twice lengthof(options)
+#define OPTINDEX_FREE 0xFFFF
+static ushort optindex[OPTINDEX_SIZE];
+static bool optindex_built = false;
+
+static uint
+optname_hash(string name)
+{
+  uint h = 2166136261u;  // FNV-1a
+  while (*name)
+    h = (h ^ (uchar)tolower((uchar)*name++)) * 16777619u;
+  return h;
+}
+
 static int
 find_option(bool from_file, string name)
 {
-  for (uint i = 0; i < lengthof(options); i++) {
-    if (!strcasecmp(name, options[i].name))
-      return i;
+  if (!optindex_built) {
+    memset(optindex, 0xFF, sizeof optindex);
+    for (uint i = 0; i < lengthof(options); i++) {
+      uint h = optname_hash(options[i].name) % OPTINDEX_SIZE;
+      while (optindex[h] != OPTINDEX_FREE)
+        h = (h + 1) % OPTINDEX_SIZE;
+      optindex[h] = i;
+    }
+    optindex_built = true;
   }
+
+  for (uint h = optname_hash(name) % OPTINDEX_SIZE;
+       optindex[h] != OPTINDEX_FREE; h = (h + 1) % OPTINDEX_SIZE)
+    if (!strcasecmp(name, options[optindex[h]].name))
+      return optindex[h];
   //__ %s: unknown option name
   opterror(_("Ignoring unknown option '%s'"), from_file, name, 0);
   return -1;
@@ -957,6 +997,9 @@ static struct {
 static ushort arg_opts[lengthof(options)];
 static uint file_opts_num = 0;
 static uint arg_opts_num;
+// per option, whether it is listed in file_opts or arg_opts
+static bool file_opts_seen[lengthof(options)];
+static bool arg_opts_seen[lengthof(options)];
 
 static void
 clear_opts(void)
@@ -966,25 +1009,20 @@ clear_opts(void)
       free(file_opts[n].comment);
   file_opts_num = 0;
   arg_opts_num = 0;
+  memset(file_opts_seen, 0, sizeof file_opts_seen);
+  memset(arg_opts_seen, 0, sizeof arg_opts_seen);
 }
 
 static bool
 seen_file_option(uint i)
 {
-//  return memchr(file_opts, i, file_opts_num);
-  for (uint n = 0; n < file_opts_num; n++)
-    if (!file_opts[n].comment && file_opts[n].opti == i)
-      return true;
-  return false;
+  return file_opts_seen[i];
 }
 
 static bool
 seen_arg_option(uint i)
 {
-  for (uint k = 0; k < arg_opts_num; k++)
-    if (arg_opts[k] == i)
-      return true;
-  return false;
+  return arg_opts_seen[i];
 }
 
 static void
@@ -1001,6 +1039,7 @@ remember_file_option(char * tag, uint i)
     file_opts[file_opts_num].comment = null;
     file_opts[file_opts_num].opti = i;
     file_opts_num++;
+    file_opts_seen[i] = true;
   }
 }
 
@@ -1026,8 +1065,10 @@ remember_arg_option(char * tag, uint i)
     exit_fatty(1);
   }
 
-  if (!seen_arg_option(i))
+  if (!seen_arg_option(i)) {
     arg_opts[arg_opts_num++] = i;
+    arg_opts_seen[i] = true;
+  }
 }
 
 static void
@@ -1403,6 +1444,61 @@ static struct {
 int nmessages = 0;
 int maxmessages = 0;
 
+/*
+   Hash index into messages (open addressing, linear probing), 
+   so that menu and dialog setup do not scan all messages per string.
+ */
+static int * msgindex = 0;
+static uint msgindex_size = 0;  // power of 2, at least twice nmessages
+
+static uint
+msghash(string msg)
+{
+  uint h = 2166136261u;  // FNV-1a
+  while (*msg)
+    h = (h ^ (uchar)*msg++) * 16777619u;
+  return h;
+}
+
+// index slot of msg, or the free slot where it belongs
+static uint
+msgindex_slot(string msg)
+{
+  uint mask = msgindex_size - 1;
+  uint i = msghash(msg) & mask;
+  while (msgindex[i] >= 0 && strcmp(msg, messages[msgindex[i]].msg) != 0)
+    i = (i + 1) & mask;
+  return i;
+}
+
+static void
+msgindex_add(int m)
+{
+  uint i = msgindex_slot(messages[m].msg);
+  // like the previous linear lookup, the first of duplicate msgids wins
+  if (msgindex[i] < 0)
+    msgindex[i] = m;
+}
+
+static void
+msgindex_reset(uint size)
+{
+  if (size != msgindex_size) {
+    msgindex_size = size;
+    msgindex = renewn(msgindex, msgindex_size);
+  }
+  for (uint i = 0; i < msgindex_size; i++)
+    msgindex[i] = -1;
+}
+
+static int
+find_message(string msg)
+{
+  if (!nmessages)
+    return -1;
+  return msgindex[msgindex_slot(msg)];
+}
+
 static void
 clear_messages()
 {
@@ -1413,6 +1509,8 @@ clear_messages()
       free(messages[i].wmsg);
   }
   nmessages = 0;
+  if (msgindex)
+    msgindex_reset(msgindex_size);
 }
 
 static void
@@ -1432,41 +1530,42 @@ add_message(char * msg, char * locmsg)
   messages[nmessages].locmsg = locmsg;
   messages[nmessages].wmsg = null;
   nmessages ++;
+
+  if ((uint)nmessages * 2 > msgindex_size) {
+    msgindex_reset(msgindex_size ? msgindex_size * 2 : 512);
+    for (int i = 0; i < nmessages; i++)
+      msgindex_add(i);
+  }
+  else
+    msgindex_add(nmessages - 1);
 }
 
 char * loctext(string msg)
 {
-  for (int i = 0; i < nmessages; i++) {
-#if defined(debug_messages) && debug_messages > 5
-    printf("?<%s> %d <%s> -> <%s>\n", msg, i, messages[i].msg, messages[i].locmsg);
-#endif
-    if (strcmp(msg, messages[i].msg) == 0) {
+  int i = find_message(msg);
+  if (i >= 0) {
 #if defined(debug_messages) && debug_messages > 4
-      printf("!<%s> %d <%s> -> <%s>\n", msg, i, messages[i].msg, messages[i].locmsg);
+    printf("!<%s> %d <%s> -> <%s>\n", msg, i, messages[i].msg, messages[i].locmsg);
 #endif
-      return messages[i].locmsg;
-    }
+    return messages[i].locmsg;
   }
   return (char *) msg;
 }
 
 wchar * wloctext(string msg)
 {
-  for (int i = 0; i < nmessages; i++) {
-#if defined(debug_messages) && debug_messages > 5
-    printf("?<%s> %d <%s> -> <%s> <%ls>\n", msg, i, messages[i].msg, messages[i].locmsg, messages[i].wmsg);
-#endif
-    if (strcmp(msg, messages[i].msg) == 0) {
+  int i = find_message(msg);
+  if (i < 0) {
+    // remember the untranslated message for its wide form
+    add_message(strdup(msg), strdup(msg));
+    i = nmessages - 1;
+  }
 #if defined(debug_messages) && debug_messages > 4
-      printf("!<%s> %d <%s> -> <%s> <%ls>\n", msg, i, messages[i].msg, messages[i].locmsg, messages[i].wmsg);
+  printf("!<%s> %d <%s> -> <%s> <%ls>\n", msg, i, messages[i].msg, messages[i].locmsg, messages[i].wmsg);
 #endif
-      if (messages[i].wmsg == null)
-        messages[i].wmsg = cs__utftowcs(messages[i].locmsg);
-      return messages[i].wmsg;
-    }
-  }
-  add_message(strdup(msg), strdup(msg));
-  return wloctext(msg);
+  if (messages[i].wmsg == null)
+    messages[i].wmsg = cs__utftowcs(messages[i].locmsg);
+  return messages[i].wmsg;
 }
 
 static char *
@@ -1733,6 +1832,9 @@ void
 load_config(string filename, int to_save)
 {
   trace_theme(("load_config <%s> %d\n", filename, to_save));
+  char * phase = asform("load_config %s", filename);
+  phase_begin(phase);
+  free(phase);
   if (!to_save) {
     // restore base configuration, without theme mix-ins
     copy_config(const_cast<char *>("load"), &cfg, &file_cfg);
@@ -1838,6 +1940,7 @@ load_config(string filename, int to_save)
     copy_config(const_cast<char *>("after load"), &file_cfg, &cfg);
   }
   //printf("load_config %s %d bd %d\n", filename, to_save, cfg.bold_as_font);
+  phase_end();
 }
 
 void
@@ -1857,11 +1960,15 @@ copy_config(char * tag, config * dst_p, const config * src_p)
       uint offset = options[i].offset;
       void *dst_val_p = (char *)dst_p + offset;
       void *src_val_p = (char *)src_p + offset;
+      // strings are only reallocated if they differ, as theme 
+      // mix-ins restore the base configuration with most of them equal
       switch (type & OPT_TYPE_MASK) {
         when OPT_STRING:
-          strset((string *)dst_val_p, *(string *)src_val_p);
+          if (!*(string *)dst_val_p || strcmp(*(string *)dst_val_p, *(string *)src_val_p))
+            strset((string *)dst_val_p, *(string *)src_val_p);
         when OPT_WSTRING:
-          wstrset((wstring *)dst_val_p, *(wstring *)src_val_p);
+          if (!*(wstring *)dst_val_p || wcscmp(*(wstring *)dst_val_p, *(wstring *)src_val_p))
+            wstrset((wstring *)dst_val_p, *(wstring *)src_val_p);
         when OPT_INT:
           *(int *)dst_val_p = *(int *)src_val_p;
         when OPT_COLOUR:
@@ -1888,14 +1995,54 @@ fix_config(void)
   cfg.rows = max(1, cfg.rows);
   cfg.cols = max(1, cfg.cols);
   cfg.scrollback_lines = max(0, cfg.scrollback_lines);
+  cfg.max_scrollback_memory = max(0, cfg.max_scrollback_memory);
+  cfg.timer_slack = max(0, cfg.timer_slack);
+  cfg.tab_pool = max(0, min(cfg.tab_pool, 16));
 
   // Limit size of scrollback buffer.
   cfg.scrollback_lines = min(cfg.scrollback_lines, cfg.max_scrollback_lines);
 }
 
+/* Compile a list of numbers (like SuppressSGR) into a bitset, 
+   to be matched like with contains() in termout.c.
+ */
+static void
+compile_numset(string s, uint * set, uint n)
+{
+  memset(set, 0, n / 8);
+  while (*s) {
+    while (*s == ',' || *s == ' ')
+      s++;
+    int si = -1;
+    int len;
+    if (sscanf(s, "%d%n", &si, &len) <= 0)
+      return;
+    s += len;
+    if ((!*s || *s == ',' || *s == ' ') && si >= 0 && (uint)si < n)
+      set[si / 32] |= 1u << (si % 32);
+  }
+}
+
+/* Compile a list of characters (like WordChars) into a bitset 
+   of UTF-16 characters, to be matched like with strchr().
+ */
+static void
+compile_charset(string s, uint * set)
+{
+  memset(set, 0, 0x10000 / 8);
+  wchar * ws = cs__utforansitowcs(s);
+  for (wchar * wp = ws; *wp; wp++)
+    set[*wp / 32] |= 1u << (*wp % 32);
+  free(ws);
+}
+
 static void
 post_config(void)
 {
+  compile_numset(cfg.suppress_sgr, suppress_sgr_set, 128);
+  compile_charset(cfg.word_chars, word_chars_set);
+  compile_charset(cfg.word_chars_excl, word_chars_excl_set);
+
   if (keyclick)
     free(keyclick);
   if (*cfg.keyclick) {
@@ -3954,8 +4101,10 @@ list_fonts(bool report)
     .outer = true
   };
 
+  phase_begin("list_fonts");
   EnumFontFamiliesW(data.dc, 0, (FONTENUMPROCW)fontenum, (LPARAM)&data);
   ReleaseDC(0, data.dc);
+  phase_end();
 }
 
 static void
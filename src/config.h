@@ -79,6 +79,8 @@ typedef struct {
   char cursor_type;
   int cursor_size;
   bool cursor_blinks;
+  int timer_slack;
+  int tab_pool;
   int config_themes;
   // Text
   font_spec font;
@@ -170,6 +172,7 @@ typedef struct {
   char rewrap_on_resize;
   int scrollback_lines;
   int max_scrollback_lines;
+  int max_scrollback_memory;
   char scrollbar;
   char scroll_mod;
   char border_style;
@@ -228,6 +231,7 @@ typedef struct {
   string filter_paste;
   int guard_path;
   int bracketed_paste_split;
+  int paste_queue_limit;
   int suspbuf_max;
   int printable_controls;
   int char_narrowing;
@@ -315,5 +319,9 @@ extern char * save_filename(char * suf);
 extern char * matchconf(char * conf, char * item);
 extern wchar * config_log;
 extern char * keyclick;
+// SuppressSGR as bitset of parameters 0...127
+extern uint suppress_sgr_set[4];
+// WordChars and WordCharsExcl as bitsets of UTF-16 characters
+extern uint word_chars_set[0x800], word_chars_excl_set[0x800];
 
 #endif
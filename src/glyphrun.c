@@ -0,0 +1,156 @@
+// glyphrun.c (part of FaTTY)
+// Licensed under the terms of the GNU General Public License v3 or later.
+
+extern "C" {
+
+#include "glyphrun.h"
+
+#define RUNCACHE_SIZE 1024  // power of 2
+#define RUNCACHE_MAXLEN 256
+
+typedef struct {
+  ulong hash;
+  uint gen;
+  uint font, mode;
+  int cell;
+  unsigned long long attr;
+  wchar * text;
+  int len, size;
+  glyphrun run;
+} runentry;
+
+static runentry runcache[RUNCACHE_SIZE];
+// entries of older generations are invalid
+static uint gen = 1;
+// runs too long to be cached
+static runentry scratch;
+
+static ulong
+runhash(const glyphrun_key * key)
+{
+  ulong h = 2166136261u;  // FNV-1a
+  auto mix = [&](ulong v) {
+    h = (h ^ v) * 16777619u;
+  };
+  mix(key->font);
+  mix(key->mode);
+  mix(key->cell);
+  mix(key->attr);
+  mix(key->attr >> 32);
+  for (int i = 0; i < key->len; i++)
+    mix(key->text[i]);
+  return h;
+}
+
+static bool
+matches(runentry * e, ulong hash, const glyphrun_key * key)
+{
+  return e->gen == gen && e->hash == hash
+      && e->font == key->font && e->mode == key->mode
+      && e->cell == key->cell && e->attr == key->attr
+      && e->len == key->len
+      && !memcmp(e->text, key->text, key->len * sizeof(wchar));
+}
+
+static void
+fill(runentry * e, ulong hash, const glyphrun_key * key, glyphrun_layout_fn layout)
+{
+  if (key->len > e->size) {
+    e->size = key->len;
+    e->text = renewn(e->text, e->size);
+    e->run.dx = renewn(e->run.dx, e->size);
+  }
+  e->hash = hash;
+  e->gen = gen;
+  e->font = key->font;
+  e->mode = key->mode;
+  e->cell = key->cell;
+  e->attr = key->attr;
+  e->len = key->len;
+  memcpy(e->text, key->text, key->len * sizeof(wchar));
+  layout(key, &e->run);
+}
+
+const glyphrun *
+glyphrun_get(const glyphrun_key * key, glyphrun_layout_fn layout)
+{
+  ulong hash = runhash(key);
+  runentry * e = key->len > RUNCACHE_MAXLEN
+                 ? &scratch : &runcache[hash & (RUNCACHE_SIZE - 1)];
+  if (e == &scratch || !matches(e, hash, key))
+    fill(e, hash, key, layout);
+  return &e->run;
+}
+
+void
+glyphrun_invalidate(void)
+{
+  gen++;
+}
+
+#ifdef GLYPHRUN_TEST
+
+static uint layouts = 0;
+
+// fake backend: font variant from attributes, double advance for 'W'
+static void
+test_layout(const glyphrun_key * key, glyphrun * run)
+{
+  layouts++;
+  run->font = key->font * 16 + (key->attr & 3);
+  run->manual_underline = key->mode & 1;
+  run->wscale = 100;
+  run->ulen = 0;
+  for (int i = 0; i < key->len; i++) {
+    run->dx[i] = key->text[i] == 'W' ? 2 * key->cell : key->cell;
+    run->ulen += key->text[i] == 'W' ? 2 : 1;
+  }
+}
+
+int
+main()
+{
+  wchar abc[] = {'a', 'W', 'c'};
+  glyphrun_key key = {0, 0, 8, 1, abc, 3};
+
+  const glyphrun * r = glyphrun_get(&key, test_layout);
+  bool ok = layouts == 1 && r->font == 1 && r->ulen == 4
+            && r->dx[0] == 8 && r->dx[1] == 16;
+  // same run again, e.g. at another position
+  r = glyphrun_get(&key, test_layout);
+  ok &= layouts == 1 && r->dx[2] == 8;
+
+  // any key component makes a difference
+  wchar abd[] = {'a', 'W', 'd'};
+  glyphrun_key other = key;
+  other.text = abd;
+  glyphrun_get(&other, test_layout);
+  ok &= layouts == 2;
+  other = key;
+  other.attr = 2;
+  ok &= glyphrun_get(&other, test_layout)->font == 2 && layouts == 3;
+  other = key;
+  other.cell = 10;
+  ok &= glyphrun_get(&other, test_layout)->dx[0] == 10 && layouts == 4;
+
+  // font or zoom change
+  glyphrun_invalidate();
+  glyphrun_get(&key, test_layout);
+  ok &= layouts == 5;
+
+  // long runs are laid out each time
+  static wchar longtext[RUNCACHE_MAXLEN + 1];
+  for (int i = 0; i <= RUNCACHE_MAXLEN; i++)
+    longtext[i] = 'x';
+  glyphrun_key longkey = {0, 0, 8, 0, longtext, RUNCACHE_MAXLEN + 1};
+  ok &= glyphrun_get(&longkey, test_layout)->ulen == RUNCACHE_MAXLEN + 1;
+  glyphrun_get(&longkey, test_layout);
+  ok &= layouts == 7;
+
+  printf("%u layouts\n", layouts);
+  return !ok;
+}
+
+#endif
+
+}
@@ -0,0 +1,37 @@
+#ifndef GLYPHRUN_H
+#define GLYPHRUN_H
+
+#include "std.h"
+
+/*
+   Cache of the layout of text runs as painted by win_text:
+   font selection and fallback decisions, and character advances;
+   independent of Windows. The layout is computed by a backend function
+   on a cache miss. The cache must be invalidated when fonts or
+   rendering options change; the cell size is part of the key.
+ */
+
+typedef struct {
+  uint font;       // font family
+  uint mode;       // line attributes and further backend mode flags
+  int cell;        // advance per character cell, in pixels
+  unsigned long long attr;  // font-relevant character attributes
+  const wchar * text;
+  int len;
+} glyphrun_key;
+
+typedef struct {
+  uint font;       // selected font variant
+  bool manual_underline;
+  short wscale;    // horizontal scaling, percent
+  int ulen;        // number of character cells
+  int * dx;        // advances, len entries
+} glyphrun;
+
+typedef void (* glyphrun_layout_fn)(const glyphrun_key * key, glyphrun * run);
+
+// the result is valid until the next call or invalidation
+extern const glyphrun * glyphrun_get(const glyphrun_key * key, glyphrun_layout_fn layout);
+extern void glyphrun_invalidate(void);
+
+#endif
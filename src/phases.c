@@ -0,0 +1,135 @@
+// phases.c (part of FaTTY)
+// Licensed under the terms of the GNU General Public License v3 or later.
+
+extern "C" {
+
+#include "phases.h"
+
+#include <time.h>
+
+#define MAX_SPANS 256
+#define MAX_DEPTH 16
+
+typedef struct {
+  char name[64];
+  long long start, dur;  // us
+  uchar depth;
+} span;
+
+static span spans[MAX_SPANS];
+static uint nspans = 0;
+static uint open_spans[MAX_DEPTH];
+static uint depth = 0;
+static bool stopped = false;
+
+static long long
+mono_us(void)
+{
+  struct timespec tim;
+  clock_gettime(CLOCK_MONOTONIC, &tim);
+  return tim.tv_sec * 1000000LL + tim.tv_nsec / 1000;
+}
+
+void
+phase_begin(string name)
+{
+  if (stopped)
+    return;
+  // spans beyond the limits are dropped, but still balanced
+  if (depth < MAX_DEPTH) {
+    if (nspans < MAX_SPANS) {
+      span * s = &spans[nspans];
+      snprintf(s->name, sizeof s->name, "%s", name);
+      s->depth = depth;
+      s->dur = -1;
+      s->start = mono_us();
+      open_spans[depth] = nspans++;
+    }
+    else
+      open_spans[depth] = MAX_SPANS;
+  }
+  depth++;
+}
+
+void
+phase_end(void)
+{
+  if (stopped || !depth)
+    return;
+  depth--;
+  if (depth < MAX_DEPTH && open_spans[depth] < MAX_SPANS) {
+    span * s = &spans[open_spans[depth]];
+    s->dur = mono_us() - s->start;
+  }
+}
+
+static void
+write_json_string(FILE * f, string s)
+{
+  fputc('"', f);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fprintf(f, "\\%c", *s);
+    else if ((uchar)*s < ' ')
+      fprintf(f, "\\u%04X", (uchar)*s);
+    else
+      fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+void
+phases_report(string filename)
+{
+  if (stopped)
+    return;
+  // close spans still open
+  while (depth)
+    phase_end();
+  stopped = true;
+  if (!filename)
+    return;
+
+  FILE * f = strcmp(filename, "-") ? fopen(filename, "w") : stdout;
+  if (!f)
+    return;
+  long long base = nspans ? spans[0].start : 0;
+  fprintf(f, "{\"traceEvents\":[");
+  for (uint i = 0; i < nspans; i++) {
+    fprintf(f, "%s\n{\"name\":", i ? "," : "");
+    write_json_string(f, spans[i].name);
+    fprintf(f, ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":1,\"args\":{\"depth\":%d}}",
+            spans[i].start - base, spans[i].dur > 0 ? spans[i].dur : 0, (int)getpid(), spans[i].depth);
+  }
+  fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  if (f == stdout)
+    fflush(f);
+  else
+    fclose(f);
+}
+
+#ifdef PHASES_TEST
+
+int
+main()
+{
+  phase_begin("startup");
+  phase_begin("config \"a\\b\"");
+  usleep(2000);
+  phase_end();
+  phase_begin("fonts");
+  phase_begin("enumerate");
+  usleep(1000);
+  phase_end();
+  phase_end();
+  phase_begin("unclosed");
+  phases_report("-");
+  phase_begin("after");
+  phase_end();
+  return !(nspans == 5 && spans[1].dur >= 2000 && spans[3].depth == 2
+           && spans[0].dur >= spans[1].dur + spans[2].dur && !depth);
+}
+
+#endif
+
+}
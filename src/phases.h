@@ -0,0 +1,19 @@
+#ifndef PHASES_H
+#define PHASES_H
+
+#include "std.h"
+
+/*
+   Startup phase tracer: named, nested spans with monotonic timestamps,
+   recorded from startup until the report is written, then disabled;
+   independent of Windows. The report is in Chrome trace event format
+   (JSON), to be viewed with chrome://tracing or Perfetto.
+ */
+
+extern void phase_begin(string name);
+extern void phase_end(void);
+// write the report (filename "-" for stdout) and stop recording;
+// with a null filename, recording stops without a report
+extern void phases_report(string filename);
+
+#endif
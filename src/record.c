@@ -0,0 +1,199 @@
+// record.c (part of FaTTY)
+// Licensed under the terms of the GNU General Public License v3 or later.
+
+extern "C" {
+
+#include "record.h"
+
+#include <time.h>
+
+#define RECORD_HEADER "fatty-record 1\n"
+
+static ulong
+mono_usec(void)
+{
+  struct timespec tim;
+  clock_gettime(CLOCK_MONOTONIC, &tim);
+  return tim.tv_sec * 1000000UL + tim.tv_nsec / 1000;
+}
+
+
+static FILE * record_file = 0;
+static ulong record_start;
+
+bool
+record_open(string filename)
+{
+  record_file = fopen(filename, "wb");
+  if (!record_file)
+    return false;
+  fputs(RECORD_HEADER, record_file);
+  record_start = mono_usec();
+  return true;
+}
+
+bool
+record_active(void)
+{
+  return record_file;
+}
+
+void
+record_data(char kind, uint tab, const char * data, uint len)
+{
+  if (!record_file || !len)
+    return;
+  fprintf(record_file, "%c %u %lu %u\n", kind, tab, mono_usec() - record_start, len);
+  fwrite(data, 1, len, record_file);
+  fputc('\n', record_file);
+  // keep the recording complete in case we are killed
+  fflush(record_file);
+}
+
+void
+record_resize(uint tab, ushort rows, ushort cols)
+{
+  if (!record_file)
+    return;
+  fprintf(record_file, "r %u %lu %u %u\n", tab, mono_usec() - record_start, rows, cols);
+  fflush(record_file);
+}
+
+
+static FILE * replay_file = 0;
+static char * replay_buf = 0;
+static uint replay_bufsize = 0;
+
+// processing time per output item, for percentiles
+static ulong * samples = 0;
+static uint nsamples = 0, maxsamples = 0;
+
+bool
+replay_open(string filename)
+{
+  replay_file = fopen(filename, "rb");
+  if (!replay_file)
+    return false;
+  char header[sizeof RECORD_HEADER];
+  if (!fgets(header, sizeof header, replay_file) || strcmp(header, RECORD_HEADER)) {
+    fclose(replay_file);
+    replay_file = 0;
+    return false;
+  }
+  return true;
+}
+
+bool
+replay_next(recitem * item)
+{
+  if (!replay_file)
+    return false;
+
+  char line[80];
+  uint rows, cols;
+  if (!fgets(line, sizeof line, replay_file))
+    return false;
+  if (sscanf(line, "r %u %lu %u %u", &item->tab, &item->usec, &rows, &cols) == 4) {
+    item->kind = 'r';
+    item->rows = rows;
+    item->cols = cols;
+    item->len = 0;
+    return true;
+  }
+  if (sscanf(line, "%c %u %lu %u", &item->kind, &item->tab, &item->usec, &item->len) != 4
+      || (item->kind != 'o' && item->kind != 'i'))
+    return false;
+
+  if (item->len + 1 > replay_bufsize) {
+    replay_bufsize = item->len + 1;
+    replay_buf = renewn(replay_buf, replay_bufsize);
+  }
+  // data is followed by a newline
+  if (fread(replay_buf, 1, item->len + 1, replay_file) != item->len + 1)
+    return false;
+  item->data = replay_buf;
+  return true;
+}
+
+void
+replay_sample(ulong usec)
+{
+  if (nsamples >= maxsamples) {
+    maxsamples = maxsamples ? maxsamples * 2 : 1024;
+    samples = renewn(samples, maxsamples);
+  }
+  samples[nsamples++] = usec;
+}
+
+static int
+cmp_ulong(const void * a, const void * b)
+{
+  ulong x = *(const ulong *)a, y = *(const ulong *)b;
+  return x < y ? -1 : x > y;
+}
+
+static ulong
+percentile(uint p)
+{
+  if (!nsamples)
+    return 0;
+  return samples[(nsamples - 1) * p / 100];
+}
+
+/*
+   Report one line of key=value pairs: output bytes and chunks,
+   elapsed time and time spent processing output, throughput
+   (of processing), percentiles of processing time per chunk,
+   and the digest of the final terminal contents.
+ */
+void
+replay_report(FILE * f, ulong bytes, ulong elapsed_usec, unsigned long long digest)
+{
+  ulong busy = 0;
+  for (uint i = 0; i < nsamples; i++)
+    busy += samples[i];
+  qsort(samples, nsamples, sizeof(ulong), cmp_ulong);
+  fprintf(f, "bytes=%lu chunks=%u elapsed_us=%lu busy_us=%lu mbps=%.2f"
+             " p50_us=%lu p90_us=%lu p99_us=%lu max_us=%lu digest=%016llX\n",
+          bytes, nsamples, elapsed_usec, busy,
+          busy ? (double)bytes / busy : 0.0,
+          percentile(50), percentile(90), percentile(99), percentile(100),
+          digest);
+  fflush(f);
+}
+
+#ifdef RECORD_TEST
+
+int
+main()
+{
+  string fn = "/tmp/record_test.rec";
+  bool ok = record_open(fn);
+  record_data('o', 0, "hello\n\0x", 8);
+  record_resize(1, 30, 100);
+  record_data('i', 1, "ls\r", 3);
+  record_data('o', 0, "", 0);  // not recorded
+  fclose(record_file);
+  record_file = 0;
+
+  recitem it;
+  ok &= replay_open(fn);
+  ok &= replay_next(&it) && it.kind == 'o' && it.tab == 0 && it.len == 8
+        && !memcmp(it.data, "hello\n\0x", 8);
+  ulong t0 = it.usec;
+  ok &= replay_next(&it) && it.kind == 'r' && it.tab == 1
+        && it.rows == 30 && it.cols == 100 && it.usec >= t0;
+  ok &= replay_next(&it) && it.kind == 'i' && it.len == 3 && !memcmp(it.data, "ls\r", 3);
+  ok &= !replay_next(&it);
+
+  for (ulong i = 1; i <= 100; i++)
+    replay_sample(101 - i);
+  replay_report(stdout, 1000000, 2000000, 0x1234ull);
+  ok &= percentile(50) == 50 && percentile(99) == 99 && percentile(100) == 100;
+  remove(fn);
+  return !ok;
+}
+
+#endif
+
+}
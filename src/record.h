@@ -0,0 +1,36 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "std.h"
+
+/*
+   Recording of pty streams with timestamps (option --record), and
+   reading and statistics for their replay (option --replay);
+   independent of Windows.
+   A recording is a text header line followed by items, each a line
+     o|i TAB USEC LEN  followed by LEN bytes of output|input and a newline
+     r TAB USEC ROWS COLS  for a window size change
+   where TAB identifies the tab and USEC is the time since recording start.
+ */
+
+typedef struct {
+  char kind;          // 'o' output, 'i' input, 'r' resize
+  uint tab;
+  ulong usec;
+  uint len;           // 'o', 'i'
+  char * data;        // 'o', 'i'; valid until the next item is read
+  ushort rows, cols;  // 'r'
+} recitem;
+
+extern bool record_open(string filename);
+extern bool record_active(void);
+extern void record_data(char kind, uint tab, const char * data, uint len);
+extern void record_resize(uint tab, ushort rows, ushort cols);
+
+extern bool replay_open(string filename);
+extern bool replay_next(recitem * item);
+// note the processing time of an output item
+extern void replay_sample(ulong usec);
+extern void replay_report(FILE * f, ulong bytes, ulong elapsed_usec, unsigned long long digest);
+
+#endif
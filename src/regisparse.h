@@ -0,0 +1,70 @@
+#ifndef REGISPARSE_H
+#define REGISPARSE_H
+
+#include "std.h"
+
+/*
+   ReGIS programs are interpreted once, when they are output, into a
+   display list of drawing primitives in ReGIS coordinates (800×480);
+   independent of Windows. The display list is rendered by regis_draw
+   whenever the graphics needs to be (re)painted, at any scale.
+   Interpreter state (cursor, write controls, macrographs) persists
+   from one ReGIS program to the next, unless reset by the DCS parameter.
+ */
+
+// drawing attributes of display list items, as set by Write Controls
+typedef struct {
+  int pattern, patternM;
+  short negative;
+  uint foreground, background;  // RGB values, as COLORREF
+  char writing_style;
+  char hatch;        // shading character, 0 for none
+  // Text Options
+  uchar text_size;   // standard character cell size 0..16
+  int text_tilt;     // degrees, counter-clockwise
+  bool text_italic;
+} regis_pen;
+
+typedef enum {
+  RG_ERASE,  // fill the screen with the background colour
+  RG_LINE,   // from x0, y0 to x1, y1; a dot if they are equal
+  RG_ARC,    // centre x0, y0, circumference point x1, y1, angle (0: circle)
+  RG_CURVE,  // n points from pts[p]
+  RG_FILL,   // fill the collected path; if closed, first add line x0, y0, x1, y1
+  RG_TEXT,   // n characters from text[p] at x0, y0, advances from adv[p]
+  RG_DELAY,  // n ticks of 1/60 seconds, only on initial display
+} regis_op;
+
+typedef struct {
+  uchar op;
+  bool path;    // add to the path to be filled by RG_FILL, rather than draw
+  bool closed;  // RG_CURVE: closed curve; RG_FILL: shaded object
+  uint pen;     // index in pens
+  float x0, y0, x1, y1;
+  int angle;
+  int n, p;
+} regis_item;
+
+typedef struct {
+  float x, y;
+} regis_point;
+
+typedef struct regis_list {
+  regis_item * items;
+  int len, size;
+  regis_pen * pens;
+  int npens, pens_size;
+  regis_point * pts;
+  int npts, pts_size;
+  wchar * text;
+  short * adv;  // character advances in ReGIS units, parallel to text
+  int ntext, text_size;
+} regis_list;
+
+// mode: DCS parameter; bit 1 resets the interpreter state
+extern regis_list * regis_parse(const char * regis, int mode);
+extern void regis_free(regis_list * rl);
+// standard character cell size, in ReGIS units
+extern void regis_cell_size(uint size, int * w, int * h);
+
+#endif
@@ -86,7 +86,8 @@ static void
 tek_buf_append(struct tekchar * tc)
 {
   if (tek_buf_len == tek_buf_size) {
-    int new_size = tek_buf_size + 1000;
+    // grow geometrically to keep appending amortized O(1)
+    int new_size = tek_buf_size ? tek_buf_size * 2 : 1000;
     struct tekchar * new_buf = renewn(tek_buf, new_size);
     if (!new_buf)
       return;
@@ -96,6 +97,36 @@ tek_buf_append(struct tekchar * tc)
   tek_buf[tek_buf_len ++] = * tc;
 }
 
+/*
+   Persistent rendering surface for tek_paint: holds the settled output 
+   (no longer glowing) of tek_buf up to tek_done, so a repaint only needs 
+   to render what was appended since;
+   replayed fully on size or colour change, font change, or page clear.
+ */
+static HDC tek_surface = 0;
+static HBITMAP tek_surface_bm = 0;
+static short tek_surface_mode;
+static int tek_surface_w, tek_surface_h;
+static colour tek_surface_fg, tek_surface_bg, tek_surface_defoc, tek_surface_thru;
+static int tek_done = 0;
+// output state after rendering tek_buf up to tek_done
+static short done_out_y, done_out_x, done_margin;
+static uchar done_lastfont;
+static int done_lastwidth;
+static POINT done_pos;
+
+static void
+tek_surface_invalidate(void)
+{
+  if (tek_surface) {
+    DeleteDC(tek_surface);
+    DeleteObject(tek_surface_bm);
+  }
+  tek_surface = 0;
+  tek_surface_bm = 0;
+  tek_done = 0;
+}
+
 static void
 tek_buf_clear(void)
 {
@@ -104,6 +135,7 @@ tek_buf_clear(void)
   tek_buf = 0;
   tek_buf_len = 0;
   tek_buf_size = 0;
+  tek_surface_invalidate();
 }
 
 
@@ -547,6 +579,8 @@ tek_set_font(wchar * fn)
 static void
 init_font(short f)
 {
+  tek_surface_invalidate();
+
   if (tekfonts[f].f)
     DeleteObject(tekfonts[f].f);
 
@@ -853,23 +887,38 @@ void
   (void)pad_r; (void)pad_b;  // could be used to clear outer pane
 
   HDC dc = GetDC(wnd);
-  HDC hdc = CreateCompatibleDC(dc);
-  HBITMAP hbm = scale_mode == 1
-                ? CreateCompatibleBitmap(dc, 4096, 3120)
-                : CreateCompatibleBitmap(dc, width, height);
-  (void)SelectObject(hdc, hbm);
 
-  // fill background
-  if (flash)
-    bg = fg0;
-  HBRUSH bgbr = CreateSolidBrush(bg);
-  RECT tmp_rect;
-  if (scale_mode == 1)
-    tmp_rect = {0, 0, 4096, 3120};
-  else
-    tmp_rect = {0, 0, width, height};
-  FillRect(hdc, &tmp_rect, bgbr);
-  DeleteObject(bgbr);
+  // set up a rendering surface with background
+  auto new_surface = [&](HBITMAP * bm) -> HDC
+  {
+    HDC hdc = CreateCompatibleDC(dc);
+    *bm = scale_mode == 1
+          ? CreateCompatibleBitmap(dc, 4096, 3120)
+          : CreateCompatibleBitmap(dc, width, height);
+    (void)SelectObject(hdc, *bm);
+
+    HBRUSH bgbr = CreateSolidBrush(bg);
+    RECT tmp_rect;
+    if (scale_mode == 1)
+      tmp_rect = {0, 0, 4096, 3120};
+    else
+      tmp_rect = {0, 0, width, height};
+    FillRect(hdc, &tmp_rect, bgbr);
+    DeleteObject(bgbr);
+    return hdc;
+  };
+  // set up coordinate mapping, return resulting scale_mode
+  auto set_transform = [&](HDC hdc, XFORM * oldxf) -> short
+  {
+    if (scale_mode == -1 && SetGraphicsMode(hdc, GM_ADVANCED)) {
+      GetWorldTransform(hdc, oldxf);
+      XFORM xform = (XFORM){(float)width / (float)4096.0, 0.0, 0.0, 
+                            (float)height / (float)3120.0, 0.0, 0.0};
+      if (ModifyWorldTransform(hdc, &xform, MWT_LEFTMULTIPLY))
+        return -1;
+    }
+    return 0;
+  };
 
   auto tx = [&](int x) -> int
   {
@@ -888,16 +937,48 @@ void
       return (3119 - y) * height / 4096;
   };
 
-  XFORM oldxf;
-  if (scale_mode == -1 && SetGraphicsMode(hdc, GM_ADVANCED)) {
-    GetWorldTransform(hdc, &oldxf);
-    XFORM xform = (XFORM){(float)width / (float)4096.0, 0.0, 0.0, 
-                          (float)height / (float)3120.0, 0.0, 0.0};
-    if (!ModifyWorldTransform(hdc, &xform, MWT_LEFTMULTIPLY))
-      scale_mode = 0;
+  // the persistent surface is not used for flashing or image export
+  bool persist = !copyfn && !flash;
+  if (tek_surface
+      && (width != tek_surface_w || height != tek_surface_h
+          || fg0 != tek_surface_fg || bg != tek_surface_bg
+          || cfg.tek_defocused_colour != tek_surface_defoc
+          || cfg.tek_write_thru_colour != tek_surface_thru
+         )
+     )
+    tek_surface_invalidate();
+
+  // fill background
+  if (flash)
+    bg = fg0;
+
+  if (persist && !tek_surface) {
+    // full replay
+    XFORM surfxf;
+    tek_surface = new_surface(&tek_surface_bm);
+    tek_surface_mode = set_transform(tek_surface, &surfxf);
+    tek_surface_w = width;
+    tek_surface_h = height;
+    tek_surface_fg = fg0;
+    tek_surface_bg = bg;
+    tek_surface_defoc = cfg.tek_defocused_colour;
+    tek_surface_thru = cfg.tek_write_thru_colour;
+    tek_done = 0;
+    done_out_x = 0;
+    done_out_y = 3120 - tekfonts[font].hei;
+    done_margin = 0;
+    done_lastfont = 4;
+    done_lastwidth = lastwidth;
+    GetCurrentPositionEx(tek_surface, &done_pos);
   }
+
+  HBITMAP hbm;
+  HDC hdc = new_surface(&hbm);
+  XFORM oldxf;
+  if (persist)
+    scale_mode = tek_surface_mode;
   else
-    scale_mode = 0;
+    scale_mode = set_transform(hdc, &oldxf);
 
   int pen_width0 = scale_mode == 1
                    ? width / 204 + height / 156
@@ -905,16 +986,8 @@ void
   // in scale_modes 0 or -1, for full width (3120×4096) pen_width should be 4
   //printf("pen width %d\n", pen_width0);
 
-  txt = 0;
-  out_x = 0;
-  out_y = 3120 - tekfonts[font].hei;
-  margin = 0;
-  lastfont = 4;
-  //printf("tek_paint %d %p\n", tek_buf_len, tek_buf);
-  //static int trc = -1;
-  for (int i = 0; i < tek_buf_len; i++) {
-    struct tekchar * tc = &tek_buf[i];
-
+  auto draw = [&](HDC hdc, struct tekchar * tc)
+  {
     int pen_width = pen_width0;
     fg = fg0;
 
@@ -989,7 +1062,7 @@ void
     else {
       if (tc->font != lastfont)
         out_flush(hdc);
-      out_char(hdc, &tek_buf[i]);
+      out_char(hdc, tc);
       // update graphic cursor in case of subsequent written first vector
       MoveToEx(hdc, tx(out_x), ty(out_y), null);
     }
@@ -1084,7 +1157,46 @@ void
           SetPixel(hdc, tx(tc->x), ty(tc->y), fgpix);
       }
     }
+  };
+
+  txt = 0;
+  int i = 0;
+  if (persist) {
+    // render output that has settled (stopped glowing) into the surface
+    out_x = done_out_x;
+    out_y = done_out_y;
+    margin = done_margin;
+    lastfont = done_lastfont;
+    lastwidth = done_lastwidth;
+    MoveToEx(tek_surface, done_pos.x, done_pos.y, null);
+    for (i = tek_done; i < tek_buf_len && !tek_buf[i].recent; i++)
+      draw(tek_surface, &tek_buf[i]);
+    out_flush(tek_surface);
+    tek_done = i;
+    done_out_x = out_x;
+    done_out_y = out_y;
+    done_margin = margin;
+    done_lastfont = lastfont;
+    done_lastwidth = lastwidth;
+    GetCurrentPositionEx(tek_surface, &done_pos);
+
+    // start the frame from a copy of the surface, 
+    // before setting up its coordinate mapping
+    BitBlt(hdc, 0, 0, width, height, tek_surface, 0, 0, SRCCOPY);
+    set_transform(hdc, &oldxf);
+    MoveToEx(hdc, done_pos.x, done_pos.y, null);
+  }
+  else {
+    out_x = 0;
+    out_y = 3120 - tekfonts[font].hei;
+    margin = 0;
+    lastfont = 4;
   }
+  //printf("tek_paint %d %p\n", tek_buf_len, tek_buf);
+  //static int trc = -1;
+  // render remaining (still glowing) output into the frame only
+  for (; i < tek_buf_len; i++)
+    draw(hdc, &tek_buf[i]);
   //if (trc == 1) trc = false;
 
   // text cursor
@@ -24,6 +24,8 @@ extern "C" {
 #if CYGWIN_VERSION_API_MINOR >= 66
 #include <langinfo.h>
 #endif
+#include <malloc.h>  // malloc_usable_size
+#include <time.h>  // clock_gettime
 
 
 
@@ -152,7 +154,8 @@ static void
 {
   TERM_VAR_REF(true)
   
-  if (term.blink_is_real)
+  // suspended in background tabs, resumed by term_set_focus
+  if (term.blink_is_real && !term.background)
     win_set_timer(tblink_cb, term_p, 500);
   else
     term.tblinker = 1;  /* reset when not in use */
@@ -182,7 +185,7 @@ static void
 {
   TERM_VAR_REF(true)
   
-  if (term.blink_is_real)
+  if (term.blink_is_real && !term.background)
     win_set_timer(tblink2_cb, term_p, 300);
   else
     term.tblinker2 = 1;  /* reset when not in use */
@@ -493,12 +496,39 @@ void
   term.search_window_visible = false;
 }
 
-static void freelines(termlines* lines, int rows) {
+/*
+ * The screen line arrays (term.lines, term.other_lines) are allocated
+ * with headroom behind the term_allrows entries in use, so that
+ * scrolling the whole screen forward only advances the array base.
+ */
+#define LINES_HEADROOM(rows) max(256, 4 * (rows))
+
+static void freelines(termlines* lines, int rows, termlines* alloc) {
   if (lines) {
     for (int i = 0; i < rows; i++)
       freeline(lines[i]);
-    free(lines);
+    free(alloc);
+  }
+}
+
+#define free_bidi_cache(...) (free_bidi_cache)(term_p, ##__VA_ARGS__)
+static void
+(free_bidi_cache)(struct term* term_p)
+{
+  TERM_VAR_REF(true)
+  
+  for (int i = 0; i < term.bidi_cache_size; i++) {
+    free(term.pre_bidi_cache[i].chars);
+    free(term.pre_bidi_cache[i].forward);
+    free(term.pre_bidi_cache[i].backward);
+    free(term.post_bidi_cache[i].chars);
+    free(term.post_bidi_cache[i].forward);
+    free(term.post_bidi_cache[i].backward);
   }
+  free(term.pre_bidi_cache);
+  free(term.post_bidi_cache);
+  term.pre_bidi_cache = term.post_bidi_cache = 0;
+  term.bidi_cache_size = 0;
 }
 
 void
@@ -506,9 +536,9 @@ term_free(struct term* term_p)
 {
   TERM_VAR_REF(true)
   
-  freelines(term.displines, term.rows);
-  freelines(term.lines, term.rows);
-  freelines(term.other_lines, term.rows);
+  freelines(term.displines, term.rows, term.displines);
+  freelines(term.lines, term.rows, term.lines_alloc);
+  freelines(term.other_lines, term.rows, term.other_lines_alloc);
 
   term_clear_scrollback();
 
@@ -523,16 +553,7 @@ term_free(struct term* term_p)
   free(term.ltemp);
   free(term.wcFrom);
   free(term.wcTo);
-  for (int i = 0; i < term.bidi_cache_size; i++) {
-    free(term.pre_bidi_cache[i].chars);
-    free(term.pre_bidi_cache[i].forward);
-    free(term.pre_bidi_cache[i].backward);
-    free(term.post_bidi_cache[i].chars);
-    free(term.post_bidi_cache[i].forward);
-    free(term.post_bidi_cache[i].backward);
-  }
-  free(term.pre_bidi_cache);
-  free(term.post_bidi_cache);
+  free_bidi_cache();
   free(term.mode_stack);
   memset(term_p, 0, sizeof(struct term));
 }
@@ -1177,6 +1198,54 @@ void
   term.results.xquery_length = 0;
 }
 
+/*
+   Memory accounting of compressed scrollback lines, per terminal and 
+   over all tabs (for MaxScrollbackMemory).
+ */
+static ulong sb_bytes_all = 0;
+
+#define sb_account(...) (sb_account)(term_p, ##__VA_ARGS__)
+static void
+(sb_account)(struct term* term_p, uchar *cline, bool add)
+{
+  TERM_VAR_REF(true)
+
+  ulong size = malloc_usable_size(cline);
+  if (add) {
+    term.sb_bytes += size;
+    sb_bytes_all += size;
+  }
+  else {
+    term.sb_bytes -= size;
+    sb_bytes_all -= size;
+  }
+}
+
+/* Monotonic clock for the timing counters of term.stats */
+ulong
+term_usec(void)
+{
+  struct timespec tim;
+  clock_gettime(CLOCK_MONOTONIC, &tim);
+  return tim.tv_sec * 1000000UL + tim.tv_nsec / 1000;
+}
+
+/*
+   Compress a line for the scrollback, with counters of input cells 
+   and allocated output.
+ */
+#define compress_line(...) (compress_line)(term_p, ##__VA_ARGS__)
+static uchar *
+(compress_line)(struct term* term_p, termline *line)
+{
+  TERM_VAR_REF(true)
+
+  uchar * cline = compressline(line);
+  term.stats.compress_in += line->cols * sizeof(termchar);
+  term.stats.compress_out += malloc_usable_size(cline);
+  return cline;
+}
+
 /*
    After term_reflow has expanded the scrollback buffer beyond its maximum 
    (for shunting lines to be rewrapped), it should trim the buffer again 
@@ -1196,8 +1265,10 @@ static void
   int new_sblines = 0;
   for (int i = 0; i < term.sblines; i++) {
     uchar *cline = term.scrollback[(i + term.sbpos) % term.sblines];
-    if (i < term.sblines - cfg.scrollback_lines)
+    if (i < term.sblines - cfg.scrollback_lines) {
+      sb_account(cline, false);
       free(cline);
+    }
     else
       scrollback[new_sblines++] = cline;
   }
@@ -1220,6 +1291,7 @@ static void
   TERM_VAR_REF(true)
 
   //printf("scrollback_push %p %d len %d lines %d tmp %d pos %d disp %d\n", line, newrows, term.sbsize, term.sblines, term.tempsblines, term.sbpos, term.disptop);
+  term.stats.sb_pushed++;
   if (term.sbpos == term.sbsize)
     term.sbpos = 0;
   if (term.sblines == term.sbsize) {
@@ -1251,6 +1323,7 @@ static void
     if (term.sblines) {
       // Throw away the oldest line;
       // sbpos needs to be normalized % sbsize here
+      sb_account(term.scrollback[term.sbpos], false);
       free(term.scrollback[term.sbpos]);
       term.sblines--;
     }
@@ -1260,6 +1333,7 @@ static void
   }
   assert(term.sblines < term.sbsize);
   assert(term.sbpos < term.sbsize);
+  sb_account(line, true);
   term.scrollback[term.sbpos++] = line;
   if (term.sbpos == term.sbsize)
     term.sbpos = 0;
@@ -1283,7 +1357,85 @@ static uchar *
   if (term.sbpos == 0)
     term.sbpos = term.sbsize;
   //printf("-> scrollback_pop len %d lines %d tmp %d pos %d disp %d\n", term.sbsize, term.sblines, term.tempsblines, term.sbpos - 1, term.disptop);
-  return term.scrollback[--term.sbpos];
+  sb_account(term.scrollback[--term.sbpos], false);
+  return term.scrollback[term.sbpos];
+}
+
+/*
+   Drop the oldest scrollback lines until the scrollback memory of all tabs 
+   is down to the given target, rebasing the ring buffer linearly as 
+   scrollback_trim does.
+ */
+#define scrollback_drop(...) (scrollback_drop)(term_p, ##__VA_ARGS__)
+static void
+(scrollback_drop)(struct term* term_p, ulong target)
+{
+  TERM_VAR_REF(true)
+
+  uchar **scrollback = newn(uchar *, term.sbsize);
+  if (!scrollback)
+    return;
+  int first = term.sbpos - term.sblines;
+  if (first < 0)
+    first += term.sbsize;
+  int new_sblines = 0;
+  for (int i = 0; i < term.sblines; i++) {
+    uchar *cline = term.scrollback[(first + i) % term.sbsize];
+    if (!new_sblines && sb_bytes_all > target) {
+      sb_account(cline, false);
+      free(cline);
+    }
+    else
+      scrollback[new_sblines++] = cline;
+  }
+  free(term.scrollback);
+  term.scrollback = scrollback;
+  term.sblines = new_sblines;
+  term.sbpos = new_sblines == term.sbsize ? 0 : new_sblines;
+  term.tempsblines = min(term.tempsblines, term.sblines);
+  term.disptop = max(term.disptop, -term.sblines);
+
+  // Clip selection markers to the remaining scrollback
+  auto clip_pos = [&](pos *p) {
+    if (p->y < -term.sblines)
+      *p = (pos){y : -term.sblines, x : 0, piy : 0, pix : 0, r : false};
+  };
+  clip_pos(&term.sel_start);
+  clip_pos(&term.sel_anchor);
+  clip_pos(&term.sel_end);
+
+  term_schedule_search_update();
+}
+
+/*
+   Keep the scrollback memory of all tabs within MaxScrollbackMemory:
+   page out the images and drop the oldest scrollback lines of the tabs 
+   that have been focused least recently first.
+ */
+static void
+enforce_scrollback_memory(void)
+{
+  ulong limit = (ulong)cfg.max_scrollback_memory << 20;
+  // leave some slack so this does not recur for every new line
+  ulong target = limit - limit / 8;
+
+  int term_num;
+  struct term ** term_pp = win_get_term_list(&term_num);
+  while (sb_bytes_all > target) {
+    struct term * term_p = 0;
+    for (int i = 0; i < term_num; i++)
+      if (term_pp[i]->sblines
+          && (!term_p || term_pp[i]->focus_tick < term_p->focus_tick)
+         )
+        term_p = term_pp[i];
+    if (!term_p)
+      break;
+    if (!term_p->has_focus)
+      winimgs_hibernate();
+    scrollback_drop(target);
+    if (term_p->sblines && sb_bytes_all > target)
+      break;  // could not allocate
+  }
 }
 
 /*
@@ -1303,6 +1455,84 @@ void
   term.disptop = 0;
 }
 
+/*
+ * Memory accounting, for OSC 7790 and the status line.
+ */
+static ulong
+memsize(void * p)
+{
+  return p ? malloc_usable_size(p) : 0;
+}
+
+static ulong
+lines_memory(termlines * lines, int rows)
+{
+  ulong bytes = 0;
+  if (lines)
+    for (int i = 0; i < rows; i++)
+      if (lines[i])
+        bytes += memsize(lines[i]) + memsize(&lines[i]->chars[-1]);
+  return bytes;
+}
+
+ulong
+(term_memory)(struct term* term_p, termmem * mem)
+{
+  TERM_VAR_REF(true)
+
+  mem->scrollback = term.sb_bytes + memsize(term.scrollback);
+  mem->lines = lines_memory(term.lines, term_allrows)
+             + lines_memory(term.other_lines, term_allrows)
+             + lines_memory(term.displines, term.rows)
+             + memsize(term.lines_alloc) + memsize(term.other_lines_alloc)
+             + memsize(term.displines);
+  for (int i = 0; i < term.bidi_cache_size; i++) {
+    bidi_cache_entry * pre = &term.pre_bidi_cache[i];
+    bidi_cache_entry * post = &term.post_bidi_cache[i];
+    mem->lines += memsize(pre->chars) + memsize(post->chars)
+                + memsize(post->forward) + memsize(post->backward);
+  }
+  mem->images = winimgs_memory();
+  mem->buffers = memsize(term.cmd_buf) + memsize(term.b64_buf)
+               + memsize(term.suspbuf);
+  return mem->scrollback + mem->lines + mem->images + mem->buffers;
+}
+
+ulong
+term_memory_all(void)
+{
+  ulong bytes = 0;
+  termmem mem;
+  WIN_FOR_EACH_TERM(bytes += term_memory(&mem));
+  return bytes;
+}
+
+/*
+   Digest of the terminal contents (scrollback, screen, cursor), 
+   to compare the outcome of replays (option --replay).
+ */
+unsigned long long
+(term_digest)(struct term* term_p)
+{
+  TERM_VAR_REF(true)
+
+  unsigned long long h = 0xCBF29CE484222325ull;  // FNV-1a basis
+  auto mix = [&](unsigned long long v) {
+    h = (h ^ v) * 0x100000001B3ull;
+  };
+  for (int y = -term.sblines; y < 0; y++) {
+    termline * line = fetch_line(y);
+    mix(line_hash(line));
+    release_line(line);
+  }
+  for (int y = 0; y < term.rows; y++)
+    mix(line_hash(term.lines[y]));
+  mix(term.curs.y);
+  mix(term.curs.x);
+  mix(term.on_alt_screen);
+  return h;
+}
+
 #define dont_debug_scrollback 1
 
 // mark cursor position in order not to lose it during reflow
@@ -1382,17 +1612,19 @@ static void
   // (lines have already been rearranged) and respective widths of each line;
   // in case of remaining problems, we couldl further move this marking 
   // to the beginning of term_resize()
-  for (int i = newrows - 1; i >= 0; i--)
+  for (int i = newrows - 1; i >= 0; i--) {
+    line_changed(term.lines[i]);
     for (int j = term.lines[i]->cols - 1; j >= 0; j--)
       if (i == term.curs.y && j == term.curs.x)
         term.lines[i]->chars[j].attr.attr |= TATTR_MARKCURS;
       else
         term.lines[i]->chars[j].attr.attr &= ~TATTR_MARKCURS;
+  }
 
   // Push all screen lines to scrollback buffer
   for (int i = 0; i < newrows; i++) {
     termline *line = term.lines[i];
-    scrollback_push(compressline(line), newrows);
+    scrollback_push(compress_line(line), newrows);
     freeline(line);
   }
   printsb("<rewrap");
@@ -1403,7 +1635,10 @@ static void
   uchar **scrollback = term.scrollback;
   int sbpos = term.sbpos;
   int sblines = term.sblines;
-  // Reset scrollback buffer (don't clear contents, which we hold locally)
+  // Reset scrollback buffer (don't clear contents, which we hold locally);
+  // scrollback_push accounts again for the lines it keeps
+  sb_bytes_all -= term.sb_bytes;
+  term.sb_bytes = 0;
   term.scrollback = 0;
   term.sbsize = term.sblines = term.sbpos = 0;
   term.tempsblines = 0;
@@ -1471,7 +1706,7 @@ static void
       else {  // need to resizeline when widening
         free(cline);
         resizeline(inbuf, newcols);
-        scrollback_push(compressline(inbuf), newrows);
+        scrollback_push(compress_line(inbuf), newrows);
       }
       cursor_scroll(inbuf);
       freeline(inbuf);
@@ -1504,7 +1739,7 @@ static void
 #ifdef skip_rewrap
     // ignore rewrap and clear out input wrap buffer, for testing
     for (int jj = 0; jj <= j; jj++) {
-      scrollback_push(compressline(linebuf[jj]), newrows);
+      scrollback_push(compress_line(linebuf[jj]), newrows);
       cursor_scroll(linebuf[jj]);
       freeline(linebuf[jj]);
     }
@@ -1522,7 +1757,7 @@ static void
 #else
 #ifdef skip_rewrap
     // ignore rewrap and clear out input wrap buffer, for testing
-    scrollback_push(compressline(inbuf), newrows);
+    scrollback_push(compress_line(inbuf), newrows);
     freeline(inbuf);
     goto wrapped;
 #endif
@@ -1583,7 +1818,7 @@ static void
         // flush current outbuf line, then make a new one
         if (lout >= 0) {
           outbuf->lattr |= LATTR_WRAPPED;
-          scrollback_push(compressline(outbuf), newrows);
+          scrollback_push(compress_line(outbuf), newrows);
           term.virtuallines++;
           cursor_scroll(outbuf);
           //printline("↑", outbuf, -1);
@@ -1623,7 +1858,7 @@ static void
     } while (true);
     // flush last outbuf line
     if (outbuf) {
-      scrollback_push(compressline(outbuf), newrows);
+      scrollback_push(compress_line(outbuf), newrows);
       cursor_scroll(outbuf);
       //printline("↑", outbuf, -1);
       freeline(outbuf);
@@ -1673,9 +1908,11 @@ static void
     }
 #ifdef change_sixel_cells
     if (changed_line) {
-      uchar * nline = compressline(line);
+      uchar * nline = compress_line(line);
       if (nline) {
         term.scrollback[(i + term.sbpos) % term.sblines] = nline;
+        sb_account(cline, false);
+        sb_account(nline, true);
         free(cline);
       }
     }
@@ -1739,6 +1976,7 @@ static void
         term.curs.y = i;
         term.curs.x = min(j, newcols - 1);
         term.lines[i]->chars[j].attr.attr &= ~TATTR_MARKCURS;
+        line_changed(term.lines[i]);
         i = 0;
         break;
       }
@@ -1838,7 +2076,7 @@ void
     // Push removed lines into scrollback
     for (int i = 0; i < store; i++) {
       termline *line = lines[i];
-      scrollback_push(compressline(line), 0);
+      scrollback_push(compress_line(line), 0);
       term.virtuallines++;
       freeline(line);
     }
@@ -1857,7 +2095,13 @@ void
     term.virtuallines += min(0, store);
   }
 
-  term.lines = lines = renewn(lines, newrows);
+  // Move the remaining lines back to the start of their allocation,
+  // leaving headroom for term_do_scroll to slide the screen into
+  if (lines != term.lines_alloc)
+    memmove(term.lines_alloc, lines, min(term.rows, newrows) * sizeof(termline *));
+  term.lines_cap = newrows + LINES_HEADROOM(newrows);
+  term.lines_alloc = renewn(term.lines_alloc, term.lines_cap);
+  term.lines = lines = term.lines_alloc;
 
   // Expand the screen if newrows > rows
   if (newrows > term.rows) {
@@ -1919,7 +2163,8 @@ void
     for (int i = 0; i < term.rows; i++)
       freeline(lines[i]);
   }
-  term.other_lines = lines = renewn(lines, newrows);
+  term.other_lines_alloc = renewn(term.other_lines_alloc, term.lines_cap);
+  term.other_lines = lines = term.other_lines_alloc;
   for (int i = 0; i < newrows; i++)
     lines[i] = newline(newcols, true);
 
@@ -2009,6 +2254,9 @@ void
   termlines *oldlines = term.lines;
   term.lines = term.other_lines;
   term.other_lines = oldlines;
+  oldlines = term.lines_alloc;
+  term.lines_alloc = term.other_lines_alloc;
+  term.other_lines_alloc = oldlines;
 
   // keep status area (xterm 373)
   if (term.st_type == 2)
@@ -2205,6 +2453,7 @@ void
       line->lattr &= ~LATTR_WRAPPED2;
     clear_cc(line, x - 1);
     clear_cc(line, x);
+    line_changed(line);
     line->chars[x - 1].chr = ' ';
     line->chars[x] = line->chars[x - 1];
   }
@@ -2293,6 +2542,8 @@ void
   TERM_VAR_REF(true)
   bool &markpos_valid = term.markpos_valid;
   
+  term.stats.scrolls++;
+
   if (term.hovering) {
     term.hovering = false;
     win_update_term(true);
@@ -2404,7 +2655,10 @@ void
     // normal screen and scrollback is actually enabled.
     if (sb && topline == 0 && !term.on_alt_screen && cfg.scrollback_lines) {
       for (int i = 0; i < lines; i++)
-        scrollback_push(compressline(term.lines[i]), 0);
+        scrollback_push(compress_line(term.lines[i]), 0);
+      if (cfg.max_scrollback_memory
+          && sb_bytes_all > (ulong)cfg.max_scrollback_memory << 20)
+        enforce_scrollback_memory();
 
       // Shift viewpoint accordingly if user is looking at scrollback
       if (term.disptop < 0)
@@ -2415,8 +2669,23 @@ void
 
     // Move up remaining lines and push in the recycled lines
     recycle(top);
-    memmove(top, top + lines, moved_lines * sizeof(termline *));
-    memcpy(bot - lines, recycled, sizeof recycled);
+    if (!topline && botline == term.rows) {
+      // Whole screen: advance the array base instead of moving all lines,
+      // falling back to the start of the allocation when out of headroom
+      if (term.lines - term.lines_alloc + lines + term_allrows > term.lines_cap) {
+        memmove(term.lines_alloc, term.lines, term_allrows * sizeof(termline *));
+        term.lines = term.lines_alloc;
+      }
+      term.lines += lines;
+      // move along status lines behind the screen
+      memmove(term.lines + term.rows, term.lines + term.rows - lines,
+              term.st_rows * sizeof(termline *));
+      memcpy(term.lines + term.rows - lines, recycled, sizeof recycled);
+    }
+    else {
+      memmove(top, top + lines, moved_lines * sizeof(termline *));
+      memcpy(bot - lines, recycled, sizeof recycled);
+    }
 
     // Move selection markers if they're within the scroll region
     auto scroll_pos = [&](pos *p) {
@@ -2516,6 +2785,7 @@ void
   else {
     termline *line = term.lines[start.y];
     while (poslt(start, end)) {
+      line_changed(line);
       int cols = min(line->cols, line->size);
       if (start.x == cols) {
         clear_wrapcontd(line, start.y);
@@ -3333,6 +3603,12 @@ void
   
   //if (kb_trace) printf("[%ld] term_paint\n", mtime());
 
+  if (term.background)
+    return;
+
+  term.stats.paints++;
+  ulong start_us = term_usec();
+
 #ifdef use_display_scrolling
   if (dispscroll_lines) {
     disp_do_scroll(dispscroll_top, dispscroll_bot, dispscroll_lines);
@@ -3737,6 +4013,8 @@ void
             struct emoji * ee = &e;
             uint em = *(uint *)ee;
             d->attr.truefg = em;
+            // d may point into the line itself
+            line_changed(line);
 
             // refresh cached copy to avoid display delay
             if (tattr.attr & TATTR_SELECTED) {
@@ -4778,6 +5056,7 @@ void
   }
 
   term.cursor_invalid = false;
+  term.stats.paint_us += term_usec() - start_us;
 }
 
 void
@@ -4862,6 +5141,31 @@ void
   }
 }
 
+/*
+ * A background (hidden) tab only maintains its screen model and 
+ * scrollback; it is not painted, its bidi cache is dropped and its 
+ * images are paged out. On activation, the window repaint (win_paint) 
+ * rebuilds the display in one full paint.
+ */
+void
+(term_set_background)(struct term* term_p, bool background)
+{
+  TERM_VAR_REF(true)
+  
+  if (background == term.background)
+    return;
+  term.background = background;
+  if (background) {
+    free_bidi_cache();
+    winimgs_hibernate();
+    term.hovering = false;
+  }
+  else {
+    term_invalidate(0, 0, term.cols - 1, term_allrows - 1);
+    term_schedule_search_update();
+  }
+}
+
 void
 (term_set_focus)(struct term* term_p, bool has_focus, bool may_report)
 {
@@ -4873,8 +5177,17 @@ void
   if (has_focus != term.has_focus) {
     term.has_focus = has_focus;
     term_schedule_cblink();
+    if (has_focus) {
+      term_schedule_tblink();
+      term_schedule_tblink2();
+    }
   }
 
+  // order of focusing, for MaxScrollbackMemory
+static uint focus_clock = 0;
+  if (has_focus)
+    term.focus_tick = ++focus_clock;
+
   if (has_focus != term.focus_reported) {
     term.focus_reported = has_focus;
 
@@ -278,10 +278,15 @@ typedef struct {
   bool temporary; /* true if decompressed from scrollback */
   short cc_free;  /* offset to first cc in free list */
   termchar *chars;
+  unsigned long long hash;  /* content hash, 0 if to be recalculated */
+  uint sum;       /* DECRQCRA checksum of the line, valid with hash */
 } termline;
 
 typedef termline * termlines;
 
+/* Invalidate cached hash and checksum after modifying line contents */
+#define line_changed(line) ((line)->hash = 0)
+
 #define newline(...) (newline)(term_p, ##__VA_ARGS__)
 extern termline *(newline)(struct term* term_p, int cols, int bce);
 extern void freeline(termline *);
@@ -300,6 +305,7 @@ extern void release_line(termline *);
 typedef struct {
   int width;
   ushort lattr;
+  unsigned long long hash;
   termchar *chars;
   int *forward, *backward;      /* the permutations of line positions */
 } bidi_cache_entry;
@@ -404,21 +410,39 @@ typedef struct {
   size_t position;
 } temp_strage_t;
 
+// image data shared by identical images, content-addressed (winimg.c)
+typedef struct imgcache {
+  struct imgcache * next;  // hash chain
+  unsigned long long hash;
+  int refs;
+  bool sixel;
+  uint size;  // data size
+  // sixel: graphic size; image: natural size as determined by GDI+
+  int pixelwidth, pixelheight;
+  // image: file data; sixel: pixels
+  unsigned char * data;
+  // image: decoded GDI+ image and its stream, retained for painting
+  void * stream;
+  void * gimg;
+} imgcache;
+
 typedef struct imglist {
   // linked list
   struct imglist * next;
   struct imglist * prev;
   // image ref for multiple use (currently unused)
   char * id;
-  // sixel: rendering data
+  // shared image data, if cached
+  imgcache * cache;
+  // sixel: rendering data; ReGIS: retained rendering
   void * hdc;
   void * hbmp;
   // sixel: disk cache
   temp_strage_t * strage;
 
-  // image data
+  // image data; ReGIS: display list (regis_list)
   unsigned char * pixels;
-  // image: data size; sixel: 0
+  // image: data size; sixel: 0; ReGIS: -1 - DCS parameter
   int len;
 
   // image ref for disposal management and for rebasing after reflow
@@ -439,6 +463,9 @@ typedef struct imglist {
   int cwidth, cheight;
   // image: cropping
   int crop_x, crop_y, crop_width, crop_height;
+  // ReGIS: pad size and state generation of retained rendering (in hdc/hbmp)
+  int rpadwidth, rpadheight;
+  uint rgen;
 
   // text attributes to be considered (blinking)
   int attr;
@@ -535,6 +562,38 @@ typedef struct {
   unsigned long last_bell;
 } term_bell;
 
+/* Streaming scanner state of the log filter (child.c) */
+typedef struct {
+  char state;
+  char strtype;          // 'o' OSC, 'd' DCS
+  uchar prefix, last;    // CSI private prefix, byte before final
+  uchar d0, d1;          // DCS leading characters
+  bool pass;             // sequence too long to be filtered, pass through
+  bool num_ok, num1_ok;  // numeric first (OSC: and second) parameter
+  bool q1, q2;           // OSC query marker in 2nd or 3rd parameter
+  uchar field, fieldpos;
+  uint num[2];
+  uint seqlen;
+  char seq[120];
+} term_log_scanner;
+
+/* Hot path counters, reported by OSC 7791 and in the status line */
+typedef struct {
+  ulong bytes;         /* output bytes parsed */
+  ulong chars;         /* printable characters written */
+  ulong csi, osc, dcs, sgr;  /* control sequences (SGR also counts as CSI) */
+  ulong scrolls;       /* scroll operations */
+  ulong sb_pushed;     /* lines pushed to scrollback */
+  ulong compress_in;   /* cells compressed into scrollback (bytes) */
+  ulong compress_out;  /* compressed scrollback lines (bytes) */
+  ulong decompress;    /* scrollback lines decompressed by fetch_line */
+  ulong paints;        /* term_paint runs */
+  ulong texts;         /* win_text calls */
+  ulong write_us;      /* time spent in term_write */
+  ulong paint_us;      /* time spent in term_paint */
+} termstats;
+extern ulong term_usec(void);
+
 struct term {
   // these used to be in term_cursor, thus affected by cursor restore
   bool decnrc_enabled;  /* DECNRCM: enable NRC */
@@ -546,6 +605,8 @@ struct term {
 
   termlines *lines;        /* Line buffer */
   termlines *other_lines;  /* switched with alternate screen */
+  termlines *lines_alloc, *other_lines_alloc;  /* allocations of the above */
+  int lines_cap;           /* allocated size of both, incl. headroom */
 
   term_cursor curs;              /* cursor */
   term_cursor saved_cursors[2];  /* saved cursor of normal/alternate screen */
@@ -558,6 +619,7 @@ struct term {
   int tempsblines;        /* number of lines of .scrollback that
                            * can be retrieved onto the terminal
                            * ("temporary scrollback") */
+  ulong sb_bytes;         /* memory held by scrollback lines */
   long long int virtuallines;
   long long int altvirtuallines;
 
@@ -607,6 +669,9 @@ struct term {
 
   bool has_focus;
   bool focus_reported;
+  uint focus_tick;        /* when the terminal was last focused */
+  bool background;        /* hidden tab: only the model is maintained */
+  termstats stats;
   bool in_vbell;
 
   int play_tone;
@@ -680,6 +745,11 @@ struct term {
   uint cmd_buf_cap;
   uint cmd_len;
   int dcs_cmd;
+  // incremental decoding of base64 payload (OSC 52, OSC 1337 File)
+  uchar b64_state;     // 0 undetermined, 1 streaming, 2 n/a, 3 failed
+  uint b64_start;      // offset of pending payload in cmd_buf
+  char *b64_buf;       // payload decoded so far
+  uint b64_len, b64_cap;
 
   uchar *tabs;
   bool newtab;
@@ -691,6 +761,8 @@ struct term {
   int progress_scan;
   int baud;
 
+  term_log_scanner log_scan;
+
   state_t state;
 
   // Mouse mode
@@ -714,6 +786,9 @@ struct term {
   bool hovering;
   int hoverlink;
   pos hover_start, hover_end;
+  // output and screen state at the last hover spreading
+  ulong hover_bytes, hover_scrolls;
+  int hover_sblines, hover_rows, hover_cols;
 
  /* Scroll steps during selection when cursor out of window. */
   int sel_scroll;
@@ -766,6 +841,19 @@ extern void (term_reset)(struct term* term_p, bool full);
 extern void term_free(struct term* term_p);
 #define term_clear_scrollback(...) (term_clear_scrollback)(term_p, ##__VA_ARGS__)
 extern void (term_clear_scrollback)(struct term* term_p);
+
+/* Memory held by a terminal, in bytes */
+typedef struct {
+  ulong scrollback;  /* compressed scrollback lines */
+  ulong lines;       /* screen and display lines, bidi caches */
+  ulong images;      /* image data not paged out */
+  ulong buffers;     /* control string, payload and suspend buffers */
+} termmem;
+#define term_memory(...) (term_memory)(term_p, ##__VA_ARGS__)
+extern ulong (term_memory)(struct term* term_p, termmem * mem);
+extern ulong term_memory_all(void);
+#define term_digest(...) (term_digest)(term_p, ##__VA_ARGS__)
+extern unsigned long long (term_digest)(struct term* term_p);
 #define term_mouse_click(...) (term_mouse_click)(term_p, ##__VA_ARGS__)
 extern bool (term_mouse_click)(struct term* term_p, mouse_button, mod_keys, pos, int count);
 #define term_mouse_release(...) (term_mouse_release)(term_p, ##__VA_ARGS__)
@@ -806,6 +894,8 @@ extern void (term_write)(struct term* term_p, const char *, uint len);
 extern void (term_flush)(struct term* term_p);
 #define term_set_focus(...) (term_set_focus)(term_p, ##__VA_ARGS__)
 extern void (term_set_focus)(struct term* term_p, bool has_focus, bool may_report);
+#define term_set_background(...) (term_set_background)(term_p, ##__VA_ARGS__)
+extern void (term_set_background)(struct term* term_p, bool background);
 #define term_cursor_type(...) (term_cursor_type)(term_p, ##__VA_ARGS__)
 extern int (term_cursor_type)(struct term* term_p);
 #define term_hide_cursor(...) (term_hide_cursor)(term_p, ##__VA_ARGS__)
@@ -480,32 +480,26 @@ void
 {
   TERM_VAR_REF(true)
   
-  int i = term.paste_pos;
-  /* We must not feed more than MAXPASTEMAX bytes into the pty in one chunk 
-     or it will block on the receiving side (write() does not return).
+  /* Feed the paste buffer to the child in chunks until its output queue 
+     reaches the high-water mark (PasteQueueLimit); child writes are 
+     non-blocking, the queue is drained from child_proc as the pty 
+     becomes writable, which then resumes pasting from here.
    */
-#define MAXPASTEMAX 7819
 #define PASTEMAX 2222
-  while (i < term.paste_len && i - term.paste_pos < PASTEMAX
-         && term.paste_buffer[i++] != '\r'
+  uint limit = max(cfg.paste_queue_limit, PASTEMAX);
+  while (term.paste_buffer && term.paste_pos < term.paste_len
+         && child_write_queued() < limit
         )
-    ;
-  if (i < term.paste_len && is_high_surrogate(term.paste_buffer[i]))
-    i++;
-  //printf("term_send_paste pos %d @ %d (len %d)\n", term.paste_pos, i, term.paste_len);
-  child_sendw(term.paste_buffer + term.paste_pos, i - term.paste_pos);
-  if (i < term.paste_len) {
+  {
+    int i = min(term.paste_pos + PASTEMAX, term.paste_len);
+    // do not split a surrogate pair
+    if (i < term.paste_len && is_low_surrogate(term.paste_buffer[i]))
+      i++;
+    //printf("term_send_paste pos %d @ %d (len %d)\n", term.paste_pos, i, term.paste_len);
+    child_sendw(term.paste_buffer + term.paste_pos, i - term.paste_pos);
     term.paste_pos = i;
-    // if only part of the paste buffer has been written to the child,
-    // the current strategy is to leave the rest pending for on-demand 
-    // invocation of term_send_paste from child_proc within the main loop,
-    // however, that causes partial loss of large paste contents;
-    // worse, without the PASTEMAX limitation, if long contents without 
-    // lineends is pasted, the terminal stalls (#810);
-    // attempts to replace the pending strategy with looping here (to 
-    // paste the whole contents) were not successful to solve the stalling
   }
-  else
+  if (term.paste_buffer && term.paste_pos >= term.paste_len)
     term_cancel_paste();
 }
 
@@ -28,6 +28,7 @@ termline *
   line->lattr = LATTR_NORM;
   line->temporary = false;
   line->cc_free = 0;
+  line->hash = 0;
   return line;
 }
 
@@ -78,6 +79,7 @@ void
 add_cc(termline *line, int col, wchar chr, cattr attr)
 {
   assert(col >= -1 && col < line->cols);
+  line_changed(line);
 
  /*
   * Start by extending the cols array if the free list is empty.
@@ -124,6 +126,7 @@ clear_cc(termline *line, int col)
 
   if (!line->chars[col].cc_next)
     return;     /* nothing needs doing */
+  line_changed(line);
 
   int oldfree = line->cc_free;
   int origcol = col;
@@ -174,6 +177,100 @@ termchars_equal(termchar *a, termchar *b)
   return termchars_equal_override(a, b, b->chr, b->attr);
 }
 
+/*
+ * DECRQCRA checksum contribution of a character cell.
+ */
+uint
+termchar_sum(termchar *tc)
+{
+  if (tc->chr == UCSWIDE)
+    return 0;
+
+  uint sum = tc->chr;  // xterm default would mask & 0xFF
+  cattrflags attr = tc->attr.attr;
+  if (attr & ATTR_UNDER)
+    sum += 0x10;
+  if (attr & ATTR_REVERSE)
+    sum += 0x20;
+  if (attr & (ATTR_BLINK | ATTR_BLINK2))
+    sum += 0x40;
+  if (attr & ATTR_BOLD)
+    sum += 0x80;
+  if (attr & ATTR_INVISIBLE) {
+    sum += 0x08;
+#ifdef xterm_before_390
+    // fixed in xterm 390: invisible char value was always 0x20
+    sum -= tc->chr;
+    sum += ' ';
+#endif
+  }
+  if (attr & ATTR_PROTECTED)
+    sum += 0x04;
+#ifdef support_vt525_color_checksum
+  // it's a bit more complex than this, supports only 16 colours, 
+  // and xterm/VT525 checksum handling is incompatible with 
+  // xterm/VT420 checksum calculation, so we skip this
+  int fg = (attr & ATTR_FGMASK) >> ATTR_FGSHIFT;
+  if (fg < 16)
+    sum += fg << 4;
+  int bg = (attr & ATTR_BGMASK) >> ATTR_BGSHIFT;
+  if (bg < 16)
+    sum += bg;
+#endif
+  while (tc->cc_next) {
+    tc += tc->cc_next;
+    sum += tc->chr & 0xFFFF;
+  }
+  return sum;
+}
+
+/*
+ * Hash the contents of a line, covering what termchars_equal compares,
+ * and calculate its DECRQCRA checksum along the way.
+ * Both are cached in the line until it is modified (line_changed), 
+ * so comparing or summing unchanged lines is cheap.
+ */
+static unsigned long long
+calc_line_hash(termline *line, uint *psum)
+{
+  unsigned long long h = 0xCBF29CE484222325ull;  // FNV-1a basis
+  auto mix = [&](unsigned long long v) {
+    h = (h ^ v) * 0x100000001B3ull;
+  };
+  uint sum = 0;
+  for (int x = 0; x < line->cols; x++) {
+    termchar *tc = &line->chars[x];
+    sum += termchar_sum(tc);
+    mix(tc->chr);
+    mix(tc->attr.attr & ~DATTR_MASK);
+    mix(tc->attr.truefg);
+    mix(tc->attr.truebg);
+    mix(tc->attr.ulcolr);
+    while (tc->cc_next) {
+      tc += tc->cc_next;
+      mix(tc->chr);
+    }
+    mix(-1);  // cell delimiter
+  }
+  *psum = sum;
+  return (h ^ (h >> 32)) ?: 1;
+}
+
+unsigned long long
+line_hash(termline *line)
+{
+  if (!line->hash)
+    line->hash = calc_line_hash(line, &line->sum);
+#ifdef debug_line_hash
+  else {
+    uint sum;
+    if (calc_line_hash(line, &sum) != line->hash || sum != line->sum)
+      printf("line_hash: stale hash %016llX\n", line->hash);
+  }
+#endif
+  return line->hash;
+}
+
 /*
  * Copy a character cell. (Requires a pointer to the destination termline,
  * so as to access its free list.)
@@ -182,6 +279,7 @@ void
 copy_termchar(termline *destline, int x, termchar *src)
 {
   clear_cc(destline, x);
+  line_changed(destline);
 
   destline->chars[x] = *src;    /* copy everything except cc-list */
   destline->chars[x].cc_next = 0;       /* and make sure this is zero */
@@ -200,6 +298,7 @@ move_termchar(termline * line, termchar *dest, termchar *src)
 {
  /* First clear the cc list from the original char, just in case. */
   clear_cc(line, dest - line->chars);
+  line_changed(line);
 
  /* Move the character cell and adjust its cc_next. */
   *dest = *src; /* copy everything except cc-list */
@@ -608,6 +707,20 @@ compressline(termline *line)
   makerle(b, line, makeliteral_attr);
   makerle(b, line, makeliteral_cc);
 
+ /*
+  * Keep the content hash and checksum if they are known; 
+  * scrollback lines do not change, so they stay valid.
+  */
+  if (line->hash) {
+    add(b, 1);
+    for (int i = 0; i < 64; i += 8)
+      add(b, (uchar) (line->hash >> i));
+    for (int i = 0; i < 32; i += 8)
+      add(b, (uchar) (line->sum >> i));
+  }
+  else
+    add(b, 0);
+
  /*
   * Trim the allocated memory so we don't waste any, and return.
   */
@@ -730,6 +843,18 @@ decompressline(uchar *data, int *bytes_used)
   readrle(b, line, readliteral_attr);
   readrle(b, line, readliteral_cc);
 
+ /*
+  * Restore content hash and checksum, if stored.
+  */
+  line->hash = 0;
+  if (get(b)) {
+    for (int i = 0; i < 64; i += 8)
+      line->hash |= (unsigned long long) get(b) << i;
+    line->sum = 0;
+    for (int i = 0; i < 32; i += 8)
+      line->sum |= (uint) get(b) << i;
+  }
+
  /* Return the number of bytes read, for diagnostic purposes. */
   if (bytes_used)
     *bytes_used = b->len;
@@ -746,6 +871,7 @@ void
   TERM_VAR_REF(true)
 
   line->lattr = LATTR_NORM;
+  line_changed(line);
   //! Note: line->chars is based @ index -1
   for (int j = -1; j < line->cols; j++)
     line->chars[j] = term.erase_char;
@@ -765,6 +891,7 @@ resizeline(termline *line, int cols)
   int oldcols = line->cols;
 
   if (cols > oldcols) {
+    line_changed(line);
 
    /*
     * Leave the same amount of cc space as there was to begin with.
@@ -836,6 +963,7 @@ termline *
       y += term.sbsize; // scrollback buffer has wrapped round
     uchar *cline = term.scrollback[y];
     line = decompressline(cline, null);
+    term.stats.decompress++;
     resizeline(line, term.cols);
   }
 
@@ -857,15 +985,14 @@ release_line(termline *line)
 /*
  * To prevent having to run the reasonably tricky bidi algorithm
  * too many times, we maintain a cache of the last lineful of data
- * fed to the algorithm on each line of the display.
+ * fed to the algorithm on each line of the display;
+ * it is matched by the content hash of the line.
  */
 static int
-(term_bidi_cache_hit)(struct term* term_p, int line, termchar *lbefore, ushort lattr, int width)
+(term_bidi_cache_hit)(struct term* term_p, int line, termline *lbefore, int width)
 {
   TERM_VAR_REF(true)
   
-  int i;
-
   if (!term.pre_bidi_cache)
     return false;       /* cache doesn't even exist yet! */
 
@@ -875,24 +1002,24 @@ static int
   if (!term.pre_bidi_cache[line].chars)
     return false;       /* cache doesn't contain _this_ line */
 
-  if (term.pre_bidi_cache[line].lattr != (lattr & LATTR_BIDIMASK))
+  if (term.pre_bidi_cache[line].lattr != (lbefore->lattr & LATTR_BIDIMASK))
     return false;       /* bidi attributes may be different */
 
   if (term.pre_bidi_cache[line].width != width)
     return false;       /* line is wrong width */
 
-  for (i = 0; i < width; i++)
-    if (!termchars_equal(term.pre_bidi_cache[line].chars + i, lbefore + i))
-      return false;     /* line doesn't match cache */
+  if (term.pre_bidi_cache[line].hash != line_hash(lbefore))
+    return false;       /* line doesn't match cache */
 
-  return true;  /* all termchars matched */
+  return true;  /* line contents matched */
 }
 
 #define term_bidi_cache_store(...) (term_bidi_cache_store)(term_p, ##__VA_ARGS__)
 static void
 (term_bidi_cache_store)(struct term* term_p, int line, 
                       termchar *lbefore, termchar *lafter, bidi_char *wcTo, 
-                      ushort lattr, int width, int size, int bidisize)
+                      ushort lattr, unsigned long long hash,
+                      int width, int size, int bidisize)
 {
   TERM_VAR_REF(true)
   
@@ -923,6 +1050,7 @@ static void
   free(term.post_bidi_cache[line].backward);
 
   term.pre_bidi_cache[line].lattr = lattr & LATTR_BIDIMASK;
+  term.pre_bidi_cache[line].hash = hash;
   term.pre_bidi_cache[line].width = width;
   term.pre_bidi_cache[line].chars = newn(termchar, size);
   term.post_bidi_cache[line].width = width;
@@ -1176,7 +1304,7 @@ termchar *
 
  /* Do Arabic shaping and bidi. */
 
-  if (term_bidi_cache_hit(scr_y, line->chars, line->lattr, term.cols))
+  if (term_bidi_cache_hit(scr_y, line, term.cols))
     return term.post_bidi_cache[scr_y].chars;
   else {
     if (term.wcFromTo_size < term.cols) {
@@ -1349,8 +1477,12 @@ termchar *
 
           // mark ALEF (if stored as combining) as joined already, 
           // to prevent its double display as an additional combining accent
-          if (is_ALEF)
+          // (this modifies the line, so its cached hash must be renewed,
+          // before the bidi cache entry is stored with it below)
+          if (is_ALEF && !(bp->attr.attr & TATTR_JOINED)) {
             bp->attr.attr |= TATTR_JOINED;
+            line_changed(line);
+          }
         }
       }
       // Arabic joining formatters: flag joiners on base character
@@ -1474,7 +1606,8 @@ termchar *
       ib++;
     }
     term_bidi_cache_store(scr_y, line->chars, term.ltemp, term.wcTo,
-                          line->lattr, term.cols, line->size, ib);
+                          line->lattr, line_hash(line),
+                          term.cols, line->size, ib);
 #ifdef debug_bidi_cache
     for (int i = 0; i < term.cols; i++)
       printf(" %04X", term.ltemp[i].chr);
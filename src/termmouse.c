@@ -33,14 +33,87 @@ get_char(termline *line, int x)
   return c;
 }
 
+/*
+ * Character classes of ASCII characters for word and URL spreading.
+ */
+enum {
+  UC_ALNUM = 1,
+  UC_WORD = 2,    // _#%~+-
+  UC_PATH = 4,    // .$@/\  (only spreading backwards)
+  UC_OPEN = 8,    // ([{
+  UC_CLOSE = 16,  // )]}
+  UC_PUNCT = 32,  // &,;?!  (not at the end)
+};
+static uchar url_class[0x80];
+
+static void
+init_url_class(void)
+{
+  if (url_class['0'])
+    return;
+  for (int c = 0; c < 0x80; c++)
+    if (iswalnum(c))
+      url_class[c] = UC_ALNUM;
+  for (char * s = const_cast<char *>("_#%~+-"); *s; s++)
+    url_class[(uchar)*s] = UC_WORD;
+  for (char * s = const_cast<char *>(".$@/\\"); *s; s++)
+    url_class[(uchar)*s] = UC_PATH;
+  for (char * s = const_cast<char *>("([{"); *s; s++)
+    url_class[(uchar)*s] = UC_OPEN;
+  for (char * s = const_cast<char *>(")]}"); *s; s++)
+    url_class[(uchar)*s] = UC_CLOSE;
+  for (char * s = const_cast<char *>("&,;?!"); *s; s++)
+    url_class[(uchar)*s] = UC_PUNCT;
+}
+
+static inline bool
+in_charset(uint * set, wchar c)
+{
+  return set[c / 32] & (1u << (c % 32));
+}
+
+/*
+ * Lines visited while spreading a word, so that scrollback lines 
+ * get decompressed only once for both directions of spreading.
+ * Consecutive lines never share a slot.
+ */
+typedef struct {
+  int y[16];
+  termline * line[16];
+} spread_lines;
+
+#define spread_line(...) (spread_line)(term_p, ##__VA_ARGS__)
+static termline *
+(spread_line)(struct term* term_p, spread_lines * sl, int y)
+{
+  int i = y & 15;
+  if (sl->line[i] && sl->y[i] == y)
+    return sl->line[i];
+  if (sl->line[i])
+    release_line(sl->line[i]);
+  sl->y[i] = y;
+  return sl->line[i] = fetch_line(y);
+}
+
+static void
+release_spread_lines(spread_lines * sl)
+{
+  for (int i = 0; i < 16; i++)
+    if (sl->line[i])
+      release_line(sl->line[i]);
+}
+
 #define sel_spread_word(...) (sel_spread_word)(term_p, ##__VA_ARGS__)
 static pos
-(sel_spread_word)(struct term* term_p, pos p, bool forward)
+(sel_spread_word)(struct term* term_p, spread_lines * sl, pos p, bool forward)
 {
   TERM_VAR_REF(true)
   
+  init_url_class();
+
   pos ret_p = p;
-  termline *line = fetch_line(p.y);
+  termline *line = spread_line(sl, p.y);
+  bool opening = term.mouse_state == MS_OPENING;
 static int level = 0;
 static char scheme = 0;
   if (!forward) {
@@ -70,7 +143,7 @@ static char scheme = 0;
     if (!forward) {
       // http://abc.xy
       //0ssss://
-      if (isalnum(c)) {
+      if (c < 0x80 && (url_class[c] & UC_ALNUM)) {
         if (scheme == ':')
           scheme = 's';
         else if (scheme != 's')
@@ -91,31 +164,31 @@ static char scheme = 0;
         scheme = 0;
     }
 
-    if (term.mouse_state != MS_OPENING && *cfg.word_chars_excl)
-      if (strchr(cfg.word_chars_excl, c))
-        break;
-    if (iswalnum(c))
+    if (!opening && in_charset(word_chars_excl_set, c))
+      break;
+    uchar cls = c < 0x80 ? url_class[c] : iswalnum(c) ? UC_ALNUM : 0;
+    if (cls & UC_ALNUM)
       ret_p = p;
-    else if (term.mouse_state != MS_OPENING && *cfg.word_chars) {
-      if (!strchr(cfg.word_chars, c))
+    else if (!opening && *cfg.word_chars) {
+      if (!in_charset(word_chars_set, c))
         break;
       ret_p = p;
     }
-    else if (strchr("_#%~+-", c))
+    else if (cls & UC_WORD)
       ret_p = p;
-    else if (strchr(".$@/\\", c)) {
+    else if (cls & UC_PATH) {
       if (!forward)
         ret_p = p;
     }
     // support URLs with parentheses (#1196)
     // distinguish opening and closing parentheses to match proper nesting
-    else if (!term.mouse_state && strchr("([{", c)) {
+    else if (!term.mouse_state && (cls & UC_OPEN)) {
       level ++;
       //printf("%d: %c forward %d level %d\n", p.x, c, forward, level);
       if (forward)
         ret_p = p;
     }
-    else if (!term.mouse_state && strchr(")]}", c)) {
+    else if (!term.mouse_state && (cls & UC_CLOSE)) {
       level --;
       //printf("%d: %c forward %d level %d\n", p.x, c, forward, level);
       if (forward && level < 0)
@@ -130,7 +203,7 @@ static char scheme = 0;
       ret_p = p;
     else if (c == (forward ? '=' : ':')) {
     }
-    else if (strchr("&,;?!", c)) {
+    else if (cls & UC_PUNCT) {
     }
     else if (forward && c == ':') {
       // could set marker in case we match : but not :: or :/
@@ -149,16 +222,14 @@ static char scheme = 0;
         if (!(line->lattr & LATTR_WRAPPED))
           break;
         p.x = 0;
-        release_line(line);
-        line = fetch_line(++p.y);
+        line = spread_line(sl, ++p.y);
       }
     }
     else {
       if (p.x <= 0) {
         if (p.y <= -sblines())
           break;
-        release_line(line);
-        line = fetch_line(--p.y);
+        line = spread_line(sl, --p.y);
         if (!(line->lattr & LATTR_WRAPPED))
           break;
         p.x = term.cols - ((line->lattr & LATTR_WRAPPED2) != 0);
@@ -168,7 +239,6 @@ static char scheme = 0;
   }
 
   //printf("%d: return\n", ret_p.x);
-  release_line(line);
   return ret_p;
 }
 
@@ -177,7 +247,7 @@ static char scheme = 0;
  * Spread the selection outwards according to the selection mode.
  */
 static pos
-(sel_spread_half)(struct term* term_p, pos p, bool forward)
+(sel_spread_half)(struct term* term_p, spread_lines * sl, pos p, bool forward)
 {
   TERM_VAR_REF(true)
     
@@ -200,7 +270,7 @@ static pos
       release_line(line);
     }
     when MS_SEL_WORD case_or MS_OPENING:
-      p = sel_spread_word(p, forward);
+      p = sel_spread_word(sl, p, forward);
     when MS_SEL_LINE:
       if (forward) {
         termline *line = fetch_line(p.y);
@@ -241,8 +311,10 @@ static void
 {
   TERM_VAR_REF(true)
   
-  term.sel_start = sel_spread_half(term.sel_start, false);
-  term.sel_end = sel_spread_half(term.sel_end, true);
+  spread_lines sl = {};
+  term.sel_start = sel_spread_half(&sl, term.sel_start, false);
+  term.sel_end = sel_spread_half(&sl, term.sel_end, true);
+  release_spread_lines(&sl);
   incpos(term.sel_end);
 }
 
@@ -253,8 +325,10 @@ static bool
   TERM_VAR_REF(true)
   
   //printf("hover_spread_empty\n");
-  term.hover_start = sel_spread_word(term.hover_start, false);
-  term.hover_end = sel_spread_word(term.hover_end, true);
+  spread_lines sl = {};
+  term.hover_start = sel_spread_word(&sl, term.hover_start, false);
+  term.hover_end = sel_spread_word(&sl, term.hover_end, true);
+  release_spread_lines(&sl);
   //printf("hover_spread_empty %d..%d\n", term.hover_start.x, term.hover_end.x);
   bool eq = term.hover_start.y == term.hover_end.y && term.hover_start.x == term.hover_end.x;
   incpos(term.hover_end);
@@ -950,7 +1024,20 @@ void
   {
     //printf("term_mouse_move link\n");
     p = get_selpoint(box_pos(p));
+    // still on the same link, and nothing has changed since spreading it
+    if (term.hovering && posle(term.hover_start, p) && poslt(p, term.hover_end)
+        && term.hover_bytes == term.stats.bytes
+        && term.hover_scrolls == term.stats.scrolls
+        && term.hover_sblines == term.sblines
+        && term.hover_rows == term.rows && term.hover_cols == term.cols
+       )
+      return;
     term.hover_start = term.hover_end = p;
+    term.hover_bytes = term.stats.bytes;
+    term.hover_scrolls = term.stats.scrolls;
+    term.hover_sblines = term.sblines;
+    term.hover_rows = term.rows;
+    term.hover_cols = term.cols;
     if (!hover_spread_empty()) {
       term.hovering = true;
       termline *line = fetch_line(p.y);
@@ -25,6 +25,7 @@ extern "C" {
 #include "sixel.h"
 #include "winimg.h"
 #include "tek.h"
+#include "regisparse.h"
 #include "base64.h"
 #include "unicodever.t"
 
@@ -36,7 +37,6 @@ extern "C" {
 #endif
 
 
-#define TERM_CMD_BUF_INC_STEP 128
 //#define TERM_CMD_BUF_MAX_SIZE (1024 * 1024)
 #define TERM_CMD_BUF_MAX_SIZE max((uint)2222, (uint)cfg.max_image_size)
 
@@ -79,35 +79,183 @@ static string primary_da5 = "\e[?65;2;3;4;6;9;11;15;21;28;29c";
 */
 
 
+/* Make room in cmd_buf for up to n more characters (and a null byte), 
+   growing it geometrically up to the maximum size; 
+   return the number of characters that fit.
+ */
+#define term_cmd_room(...) (term_cmd_room)(term_p, ##__VA_ARGS__)
+static uint
+(term_cmd_room)(struct term* term_p, uint n)
+{
+  TERM_VAR_REF(true)
+  
+  /* Need 1 more for null byte */
+  if (term.cmd_len + n < term.cmd_buf_cap)
+    return n;
+
+  uint max_size = TERM_CMD_BUF_MAX_SIZE;
+  if (term.cmd_buf_cap < max_size) {
+    uint new_size = max(term.cmd_buf_cap * 2, term.cmd_len + n + 1);
+    if (new_size >= max_size) {
+      // cosmetic limitation (relevant limitation below)
+      new_size = max_size;
+    }
+    term.cmd_buf = renewn(term.cmd_buf, new_size);
+    term.cmd_buf_cap = new_size;
+  }
+
+  /* Server sends too many cmd characters */
+  return min(n, term.cmd_buf_cap - 1 - term.cmd_len);
+}
+
 #define term_push_cmd(...) (term_push_cmd)(term_p, ##__VA_ARGS__)
 static bool
 (term_push_cmd)(struct term* term_p, char c)
 {
   TERM_VAR_REF(true)
   
-  uint new_size;
+  if (!term_cmd_room(1))
+    return false;
+  term.cmd_buf[term.cmd_len++] = c;
+  term.cmd_buf[term.cmd_len] = 0;
+  return true;
+}
 
-  /* Need 1 more for null byte */
-  if (term.cmd_len + 1 < term.cmd_buf_cap) {
-    term.cmd_buf[term.cmd_len++] = c;
-    term.cmd_buf[term.cmd_len] = 0;
-    return true;
-  }
+/* Append a span of characters to cmd_buf; 
+   return the number of characters that fit.
+ */
+#define term_push_cmds(...) (term_push_cmds)(term_p, ##__VA_ARGS__)
+static uint
+(term_push_cmds)(struct term* term_p, const char * s, uint n)
+{
+  TERM_VAR_REF(true)
+  
+  n = term_cmd_room(n);
+  memcpy(term.cmd_buf + term.cmd_len, s, n);
+  term.cmd_len += n;
+  term.cmd_buf[term.cmd_len] = 0;
+  return n;
+}
+
+/* Base64 payloads of OSC 52 and OSC 1337 File= are decoded 
+   incrementally in chunks of this size while they arrive.
+ */
+#define B64_CHUNK 0x10000
 
-  if (term.cmd_buf_cap >= TERM_CMD_BUF_MAX_SIZE) {
-    /* Server sends too many cmd characters */
+#define b64_reset(...) (b64_reset)(term_p, ##__VA_ARGS__)
+static void
+(b64_reset)(struct term* term_p)
+{
+  TERM_VAR_REF(true)
+  
+  if (term.b64_buf)
+    free(term.b64_buf);
+  term.b64_buf = 0;
+  term.b64_len = term.b64_cap = 0;
+  term.b64_start = 0;
+  term.b64_state = 0;
+}
+
+/* Decode n base64 characters into b64_buf; 
+   its size is limited like cmd_buf (but for decoded data now).
+ */
+#define b64_decode(...) (b64_decode)(term_p, ##__VA_ARGS__)
+static bool
+(b64_decode)(struct term* term_p, const char * s, uint n)
+{
+  TERM_VAR_REF(true)
+  
+  uint need = term.b64_len + n / 4 * 3 + 1;
+  if (need > TERM_CMD_BUF_MAX_SIZE)
     return false;
+  if (need > term.b64_cap) {
+    uint new_size = max(term.b64_cap + term.b64_cap / 2, need);
+    new_size = min(new_size, (uint)TERM_CMD_BUF_MAX_SIZE);
+    char * new_buf = renewn(term.b64_buf, new_size);
+    if (!new_buf)
+      return false;
+    term.b64_buf = new_buf;
+    term.b64_cap = new_size;
   }
-  new_size = term.cmd_buf_cap + TERM_CMD_BUF_INC_STEP;
-  if (new_size >= TERM_CMD_BUF_MAX_SIZE) {
-    // cosmetic limitation (relevant limitation above)
-    new_size = TERM_CMD_BUF_MAX_SIZE;
+  int len = base64_decode_clip(s, n, term.b64_buf + term.b64_len, 
+                               term.b64_cap - 1 - term.b64_len);
+  if (len < 0)
+    return false;
+  term.b64_len += len;
+  return true;
+}
+
+/* Check for a decodable chunk of OSC base64 payload, 
+   decode it and remove it from cmd_buf.
+ */
+#define b64_stream(...) (b64_stream)(term_p, ##__VA_ARGS__)
+static void
+(b64_stream)(struct term* term_p)
+{
+  TERM_VAR_REF(true)
+  
+  if (!term.b64_state) {
+    // locate payload after header
+    char * sep = (char *)memchr(term.cmd_buf, 
+                                term.cmd_num == 52 ? ';' : ':', term.cmd_len);
+    if (!sep || (term.cmd_num == 1337 && strncmp(term.cmd_buf, "File=", 5))) {
+      // not applicable, or excessive header: leave it to do_cmd
+      term.b64_state = 2;
+      return;
+    }
+    term.b64_start = sep + 1 - term.cmd_buf;
+    term.b64_state = 1;
+
+    // preallocate by announced file size
+    char * size = 0;
+    if (term.cmd_num == 1337) {
+      for (char * p = term.cmd_buf + 4; p < sep; p++)
+        if ((*p == ';' || *p == '=') && !strncmp(p + 1, "size=", 5)) {
+          size = p + 6;
+          break;
+        }
+    }
+    if (size) {
+      uint cap = strtoul(size, 0, 10) + 1;
+      if (cap > 1 && cap <= TERM_CMD_BUF_MAX_SIZE) {
+        term.b64_buf = newn(char, cap);
+        term.b64_cap = cap;
+      }
+    }
   }
-  term.cmd_buf = renewn(term.cmd_buf, new_size);
-  term.cmd_buf_cap = new_size;
-  term.cmd_buf[term.cmd_len++] = c;
+
+  uint n = term.cmd_len - term.b64_start;
+  uint rest = n % 4;
+  n -= rest;
+  if (term.b64_state == 1 && !b64_decode(term.cmd_buf + term.b64_start, n))
+    term.b64_state = 3;  // discard further payload
+  // keep an incomplete base64 group
+  memmove(term.cmd_buf + term.b64_start, 
+          term.cmd_buf + term.b64_start + n, rest);
+  term.cmd_len = term.b64_start + rest;
   term.cmd_buf[term.cmd_len] = 0;
-  return true;
+}
+
+/* Finish base64 payload decoding, 
+   starting at the remaining payload in cmd_buf; 
+   return decoded length, or negative in case of failure, 
+   pass decoded data (null-terminated) to caller.
+ */
+#define b64_result(...) (b64_result)(term_p, ##__VA_ARGS__)
+static int
+(b64_result)(struct term* term_p, char * payload, char * * data)
+{
+  TERM_VAR_REF(true)
+  
+  int len = -1;
+  if (term.b64_state != 3 && b64_decode(payload, strlen(payload))) {
+    len = term.b64_len;
+    term.b64_buf[len] = 0;
+    *data = term.b64_buf;
+    term.b64_buf = 0;
+  }
+  b64_reset();
+  return len;
 }
 
 #define enable_progress(...) (enable_progress)(term_p, ##__VA_ARGS__)
@@ -277,6 +425,7 @@ static void
   m = cols - curs->x - n;
   term_check_boundary(curs->x, curs->y);
   term_check_boundary(curs->x + m, curs->y);
+  line_changed(line);
   if (del) {
     for (int j = 0; j < m; j++)
       move_termchar(line, line->chars + curs->x + j,
@@ -352,6 +501,7 @@ static void
 
   for (int y = y0; y <= y1; y++) {
     termline * l = term.lines[y];
+    line_changed(l);
     int xl = x0;
     int xr = x1;
     if (term.attr_rect < 2) {
@@ -496,6 +646,7 @@ static void
 
   for (int y = y0; y <= y1; y++) {
     termline * l = term.lines[y];
+    line_changed(l);
     bool prevprot = true;  // not false!
     for (int x = x0; x <= x1; x++) {
       //printf("fill %d:%d\n", y, x);
@@ -720,49 +871,14 @@ static uint
   uint sum = 0;
   for (int y = y0; y <= y1; y++) {
     termline * line = term.lines[y];
-    for (int x = x0; x <= x1; x++) {
-      //printf("add %d:%d\n", y, x);
-      if (line->chars[x].chr == UCSWIDE) {
-      }
-      else {
-        sum += line->chars[x].chr;  // xterm default would mask & 0xFF
-        cattrflags attr = line->chars[x].attr.attr;
-        if (attr & ATTR_UNDER)
-          sum += 0x10;
-        if (attr & ATTR_REVERSE)
-          sum += 0x20;
-        if (attr & (ATTR_BLINK | ATTR_BLINK2))
-          sum += 0x40;
-        if (attr & ATTR_BOLD)
-          sum += 0x80;
-        if (attr & ATTR_INVISIBLE) {
-          sum += 0x08;
-#ifdef xterm_before_390
-          // fixed in xterm 390: invisible char value was always 0x20
-          sum -= line->chars[x].chr;
-          sum += ' ';
-#endif
-        }
-        if (attr & ATTR_PROTECTED)
-          sum += 0x04;
-#ifdef support_vt525_color_checksum
-        // it's a bit more complex than this, supports only 16 colours, 
-        // and xterm/VT525 checksum handling is incompatible with 
-        // xterm/VT420 checksum calculation, so we skip this
-        int fg = (attr & ATTR_FGMASK) >> ATTR_FGSHIFT;
-        if (fg < 16)
-          sum += fg << 4;
-        int bg = (attr & ATTR_BGMASK) >> ATTR_BGSHIFT;
-        if (bg < 16)
-          sum += bg;
-#endif
-        int xc = x;
-        while (line->chars[xc].cc_next) {
-          xc += line->chars[xc].cc_next;
-          sum += line->chars[xc].chr & 0xFFFF;
-        }
-      }
+    if (x0 == 0 && x1 == term.cols - 1 && line->cols == term.cols) {
+      // full line: use cached checksum
+      line_hash(line);
+      sum += line->sum;
     }
+    else
+      for (int x = x0; x <= x1; x++)
+        sum += termchar_sum(&line->chars[x]);
   }
   return sum;
 }
@@ -830,6 +946,7 @@ static termline *
   curs->x = term.marg_left;
   curs->wrapnext = false;
   line = term.lines[curs->y];
+  line_changed(line);
   wrapparabidi(parabidi, line, curs->y);
 
   return line;
@@ -889,6 +1006,7 @@ static void
     (void)do_wrap(line, LATTR_WRAPPED);
   }
 
+  line_changed(term.lines[curs->y]);
   int last = -1;
   do {
     if (curs->x == term.marg_right)
@@ -950,6 +1068,40 @@ static void
   curs->wrapnext = false;
 }
 
+#define scroll_ahead(...) (scroll_ahead)(term_p, ##__VA_ARGS__)
+/*
+ * On a linefeed at the bottom of the screen, look ahead in the output 
+ * for further linefeeds and scroll for all of them at once, moving the 
+ * cursor up accordingly, so that the following linefeeds only need 
+ * to move it down again. Only text, CR and HT may intervene; 
+ * they do not depend on the position of lines on the screen, 
+ * so the resulting state is the same as with stepwise scrolling.
+ */
+static void
+(scroll_ahead)(struct term* term_p, const char * s, uint len)
+{
+  TERM_VAR_REF(true)
+  
+  term_cursor *curs = &term.curs;
+  if (curs->y != term.marg_bot || term.marg_bot != term.rows - 1
+      || term.st_active || term.lrmargmode || tek_mode)
+    return;
+
+  int room = term.marg_bot - term.marg_top;
+  int n = 1;  // the current linefeed
+  for (uint i = 0; i < len && n < room; i++) {
+    uchar c = s[i];
+    if (c == '\n')
+      n++;
+    else if (c < ' ' && c != '\r' && c != '\t')
+      break;
+  }
+  if (n > 1) {
+    term_do_scroll(term.marg_top, term.marg_bot, n, true);
+    curs->y -= n;
+  }
+}
+
 static bool
 contains(string s, int i)
 {
@@ -1079,6 +1231,8 @@ void
 {
   TERM_VAR_REF(true)
   
+  term.stats.chars++;
+
   //if (kb_trace) printf("[%ld] write_char 'q'\n", mtime());
 
   if (tek_mode) {
@@ -1091,6 +1245,7 @@ void
 
   term_cursor * curs = &term.curs;
   termline * line = term.lines[curs->y];
+  line_changed(line);
 
   // support non-BMP for the REP function;
   // this is a hack, it would be cleaner to fold the term_write block
@@ -2163,6 +2318,7 @@ static void
             (termchar) {.cc_next = 0, .chr = 'E', .attr = CATTR_DEFAULT};
         }
         line->lattr = LATTR_NORM;
+        line_changed(line);
       }
       term.curs.attr = savattr;
       term.disptop = 0;
@@ -2230,16 +2386,91 @@ static void
   last_char = 0;  // cancel preceding char for REP
 }
 
+static inline bool
+sgr_suppressed(uint arg)
+{
+  return arg < 128 && (suppress_sgr_set[arg / 32] >> (arg % 32) & 1);
+}
+
+/* Cache of SGR transitions: 
+   the few SGR sequences that applications emit repeatedly 
+   (like \e[0m, \e[1;31m, \e[38;5;244m) are mapped from the previous 
+   attributes to the resulting ones in one lookup.
+   Parameters 10...20 (font and character set switching, with side effects) 
+   and 58 (palette-dependent underline colour) are not cached.
+ */
+#define SGR_CACHE_SIZE 64
+#define SGR_CACHE_ARGS 8
+
+static struct sgr_cache {
+  uint argc;  // 0: unused
+  uint argv[SGR_CACHE_ARGS];
+  cattr from, to;
+} sgr_cache[SGR_CACHE_SIZE];
+// SuppressSGR setting the cache is valid for
+static uint sgr_cache_suppress[4];
+#define dont_debug_sgr_cache
+static uint sgr_cache_hits = 0, sgr_cache_misses = 0;
+
+static inline bool
+cattr_equal(cattr * a, cattr * b)
+{
+  return a->attr == b->attr && a->truefg == b->truefg
+      && a->truebg == b->truebg && a->ulcolr == b->ulcolr
+      && a->link == b->link && a->imgi == b->imgi;
+}
+
 #define do_sgr(...) (do_sgr)(term_p, ##__VA_ARGS__)
 static void
 (do_sgr)(struct term* term_p)
 {
   TERM_VAR_REF(true)
   
+  term.stats.sgr++;
+
  /* Set Graphics Rendition. */
   uint argc = term.csi_argc;
   cattr attr = term.curs.attr;
   uint prot = attr.attr & ATTR_PROTECTED;
+
+  // look up cached transition
+  struct sgr_cache * sc = 0;
+  if (argc && argc <= SGR_CACHE_ARGS) {
+    if (memcmp(sgr_cache_suppress, suppress_sgr_set, sizeof sgr_cache_suppress)) {
+      // SuppressSGR changed
+      memset(sgr_cache, 0, sizeof sgr_cache);
+      memcpy(sgr_cache_suppress, suppress_sgr_set, sizeof sgr_cache_suppress);
+    }
+    uint h = (uint)attr.attr ^ (uint)(attr.attr >> 32) ^ attr.truefg;
+    bool cacheable = true;
+    for (uint i = 0; i < argc; i++) {
+      uint arg = term.csi_argv[i];
+      uint a = arg & ~SUB_PARS;
+      if ((a >= 10 && a <= 20) || a == 58) {
+        cacheable = false;
+        break;
+      }
+      h = (h ^ arg) * 0x01000193;
+    }
+    if (cacheable) {
+      sc = &sgr_cache[(h ^ h >> 16) % SGR_CACHE_SIZE];
+      if (sc->argc == argc
+          && !memcmp(sc->argv, term.csi_argv, argc * sizeof(uint))
+          && cattr_equal(&sc->from, &attr)
+         )
+      {
+        sgr_cache_hits++;
+        attr = sc->to;
+        goto set_attr;
+      }
+      sgr_cache_misses++;
+      // prepare entry (parameters are modified below)
+      sc->argc = 0;
+      memcpy(sc->argv, term.csi_argv, argc * sizeof(uint));
+      sc->from = attr;
+    }
+  }
+
   for (uint i = 0; i < argc; i++) {
     // support colon-separated sub parameters as specified in
     // ISO/IEC 8613-6 (ITU Recommendation T.416)
@@ -2255,8 +2486,7 @@ static void
         else
           break;
       }
-    if (*cfg.suppress_sgr
-        && contains(cfg.suppress_sgr, term.csi_argv[i] & ~SUB_PARS))
+    if (sgr_suppressed(term.csi_argv[i] & ~SUB_PARS))
     {
       // skip suppressed attribute (but keep processing sub_pars)
       // but turn some sequences into virtual sub-parameters
@@ -2517,6 +2747,16 @@ static void
     // skip sub parameters
     i += sub_pars;
   }
+  if (sc) {
+    sc->to = attr;
+    sc->argc = argc;
+  }
+#ifdef debug_sgr_cache
+  if (!((sgr_cache_hits + sgr_cache_misses) % 10000))
+    printf("SGR cache hits %u misses %u\n", sgr_cache_hits, sgr_cache_misses);
+#endif
+
+set_attr:
   term.curs.attr = attr;
   term.erase_char.attr = attr;
   term.erase_char.attr.attr &= (ATTR_FGMASK | ATTR_BGMASK);
@@ -3125,8 +3365,10 @@ pop_colours(uint ix)
   }
   //printf("pop %d\n", ix);
 
-  if (colours_stack[ix])
+  if (colours_stack[ix]) {
     memcpy(colours, colours_stack[ix], COLOUR_NUM * sizeof(COLORREF));
+    win_colours_changed();
+  }
 }
 
 #define do_winop(...) (do_winop)(term_p, ##__VA_ARGS__)
@@ -3283,6 +3525,8 @@ static void
 {
   TERM_VAR_REF(true)
   
+  term.stats.csi++;
+
   term_cursor *curs = &term.curs;
   int arg0 = term.csi_argv[0], arg1 = term.csi_argv[1];
   if (arg0 < 0)
@@ -3391,6 +3635,7 @@ static void
         int p = curs->x;
         term_check_boundary(curs->x, curs->y);
         term_check_boundary(curs->x + n, curs->y);
+        line_changed(line);
         while (n--) {
           if (!term.iso_guarded_area ||
               !(line->chars[p].attr.attr & ATTR_PROTECTED)
@@ -4057,6 +4302,7 @@ static void
               (termchar) {.cc_next = 0, .chr = ' ', attr};
           }
           line->lattr = LATTR_NORM;
+          line_changed(line);
         }
         term.disptop = 0;
       }
@@ -4199,6 +4445,26 @@ static void
   term.curs.attr.attr = attr0;
 }
 
+/* Feed a chunk of DECSIXEL data to the sixel parser; 
+   on failure, discard the parser state.
+ */
+#define sixel_parse(...) (sixel_parse)(term_p, ##__VA_ARGS__)
+static bool
+(sixel_parse)(struct term* term_p, const char * s, uint len)
+{
+  TERM_VAR_REF(true)
+  
+  sixel_state_t * st = (sixel_state_t *)term.imgs.parser_state;
+  if (sixel_parser_parse(st, (unsigned char *)s, len) < 0) {
+    sixel_parser_deinit(st);
+    //printf("free state 1 %p\n", term.imgs.parser_state);
+    free(term.imgs.parser_state);
+    term.imgs.parser_state = NULL;
+    return false;
+  }
+  return true;
+}
+
 #define do_dcs(...) (do_dcs)(term_p, ##__VA_ARGS__)
 static void
 (do_dcs)(struct term* term_p)
@@ -4238,7 +4504,8 @@ static void
     if (term.state == DCS_ESCAPE) {
       uint regarg = *term.csi_argv;
 
-      unsigned char * regis = (unsigned char *)strdup(term.cmd_buf);
+      // interpret the ReGIS program, in output order as its state persists
+      regis_list * regis = regis_parse(term.cmd_buf, regarg);
 
       short left = term.curs.x;
       short top = term.sixel_display ? 0: term.curs.y;
@@ -4259,8 +4526,8 @@ static void
       int height = (pixelheight - 1) / cell_height + 1;
 
       imglist * img;
-      if (!winimg_new(&img, 0, regis, -1 - regarg, left, top, width, height, pixelwidth, pixelheight, false, 0, 0, 0, 0, term.curs.attr.attr & (ATTR_BLINK | ATTR_BLINK2))) {
-        free(regis);
+      if (!winimg_new(&img, 0, (unsigned char *)regis, -1 - regarg, left, top, width, height, pixelwidth, pixelheight, false, 0, 0, 0, 0, term.curs.attr.attr & (ATTR_BLINK | ATTR_BLINK2))) {
+        regis_free(regis);
         return;
       }
 
@@ -4285,12 +4552,7 @@ static void
     when DCS_PASSTHROUGH: {
       if (!st)
         return;
-      status = sixel_parser_parse(st, (unsigned char *)s, term.cmd_len);
-      if (status < 0) {
-        sixel_parser_deinit(st);
-        //printf("free state 1 %p\n", term.imgs.parser_state);
-        free(term.imgs.parser_state);
-        term.imgs.parser_state = NULL;
+      if (!sixel_parse(s, term.cmd_len)) {
         term.state = DCS_IGNORE;
         return;
       }
@@ -4299,14 +4561,8 @@ static void
     when DCS_ESCAPE: {
       if (!st)
         return;
-      status = sixel_parser_parse(st, (unsigned char *)s, term.cmd_len);
-      if (status < 0) {
-        sixel_parser_deinit(st);
-        //printf("free state 2 %p\n", term.imgs.parser_state);
-        free(term.imgs.parser_state);
-        term.imgs.parser_state = NULL;
+      if (!sixel_parse(s, term.cmd_len))
         return;
-      }
 
       unsigned char * pixels = sixel_parser_finalize(st);
       //printf("sixel_parser_finalize %p\n", pixels);
@@ -4763,7 +5019,6 @@ static void
   
   char *s = term.cmd_buf;
   char *output;
-  int len;
   int ret;
 
   char buf_indicator = 0;
@@ -4804,22 +5059,15 @@ static void
     return;
   }
 
-  len = strlen(s);
-
-  output = (char *)malloc(len + 1);
-  if (output == NULL) {
-    return;
-  }
-
-  ret = base64_decode_clip(s, len, output, len);
-  if (ret > 0) {
-    output[ret] = '\0';
+  // decode remaining payload, following what was streamed already
+  ret = b64_result(s, &output);
+  if (ret > 0)
     win_copy_text(output);
-  }
   else
     // clear selection
     win_copy(W(""), 0, 1);
-  free(output);
+  if (ret >= 0)
+    free(output);
 }
 
 #define respond_capabilities(...) (respond_capabilities)(term_p, ##__VA_ARGS__)
@@ -4886,6 +5134,8 @@ static void
 {
   TERM_VAR_REF(true)
   
+  term.stats.osc++;
+
   char *s = term.cmd_buf;
   s[term.cmd_len] = 0;
   //printf("OSC %d <%s> %s\n", term.cmd_num, s, term.state == CMD_ESCAPE ? "ST" : "BEL");
@@ -5028,6 +5278,34 @@ static void
         else
           win_set_font_size(i, true);
       }
+    when 7790:  // Query memory usage of terminal and of all tabs.
+      if (!strcmp(s, "?")) {
+        termmem mem;
+        term_memory(&mem);
+        child_printf("\e]7790;%lu;%lu;%lu;%lu;%lu%s",
+                     mem.scrollback, mem.lines, mem.images, mem.buffers,
+                     term_memory_all(), osc_fini());
+      }
+    when 7791:  // Query or reset hot path counters of terminal.
+      if (!strcmp(s, "?")) {
+        termstats * st = &term.stats;
+        // image cache, shared by all tabs
+        uint imghits, imgmisses, imgentries;
+        ulong imgbytes;
+        winimg_cache_stats(&imghits, &imgmisses, &imgentries, &imgbytes);
+        child_printf("\e]7791;bytes=%lu;chars=%lu;csi=%lu;osc=%lu;dcs=%lu;sgr=%lu"
+                     ";scrolls=%lu;sbpush=%lu;compin=%lu;compout=%lu;decomp=%lu"
+                     ";paints=%lu;texts=%lu;writeus=%lu;paintus=%lu"
+                     ";imghits=%u;imgmisses=%u;imgentries=%u;imgbytes=%lu%s",
+                     st->bytes, st->chars, st->csi, st->osc, st->dcs, st->sgr,
+                     st->scrolls, st->sb_pushed, st->compress_in,
+                     st->compress_out, st->decompress,
+                     st->paints, st->texts, st->write_us, st->paint_us,
+                     imghits, imgmisses, imgentries, imgbytes,
+                     osc_fini());
+      }
+      else if (!strcmp(s, "0"))
+        memset(&term.stats, 0, sizeof term.stats);
     when 7771: {  // Enquire about font support for a list of characters
       if (*s++ != '?')
         return;
@@ -5307,12 +5585,11 @@ static void
           *to = 0;
         }
 #endif
-        int len = strlen(payload);
-        int datalen = len - (len / 4);
-        void * data = malloc(datalen);
-        if (!data)
+        // decode remaining payload, following what was streamed already
+        char * data;
+        int datalen = b64_result(payload, &data);
+        if (datalen < 0)
           return;
-        datalen = base64_decode_clip(payload, len, (char *)data, datalen);
         if (datalen > 0) {
           // OK
           imglist * img;
@@ -5475,6 +5752,13 @@ static void
   term.cblinker = 1;
   term_schedule_cblink();
 
+  // count output from the child, not bytes injected recursively
+  ulong start_us = 0;
+  if (fix_status) {
+    term.stats.bytes += len;
+    start_us = term_usec();
+  }
+
   short oldy = term.curs.y;
 
   uint pos = 0;
@@ -5911,6 +6195,8 @@ static void
 
         // Control characters
         if (wc < 0x20 || wc == 0x7F) {
+          if (wc == '\n' && c == wc)
+            scroll_ahead(buf + pos, len - pos);
           if (!do_ctrl(wc) && c == wc) {
             // the rôle of function cs_btowc_glyph in this case is unclear
             wc = cs_btowc_glyph(c);
@@ -6065,6 +6351,7 @@ static void
 
       when OSC_START:
         term.cmd_len = 0;
+        b64_reset();
         switch (c) {
           when 'P':  /* Linux palette sequence */
             term.state = OSC_PALETTE;
@@ -6151,6 +6438,19 @@ static void
             // else ignore new lines in base64-encoded images
           othwise:
             term_push_cmd(c);
+            if (!term.printing) {
+              // take plain string contents in bulk
+              uint end = pos;
+              while (end < len && (uchar)buf[end] >= ' ')
+                end++;
+              term_push_cmds(buf + pos, end - pos);
+              pos = end;
+            }
+            if ((term.cmd_num == 52 || term.cmd_num == 1337)
+                && term.b64_state != 2
+                && term.cmd_len >= term.b64_start + B64_CHUNK
+               )
+              b64_stream();
         }
 
       when IGNORE_STRING:
@@ -6176,6 +6476,7 @@ static void
         switch (c) {
           when '@' ... '~':  /* DCS cmd final byte */
             term.dcs_cmd = c;
+            term.stats.dcs++;
             do_dcs();
             term.state = DCS_PASSTHROUGH;
           when '\e':
@@ -6208,6 +6509,7 @@ static void
             //printf("dcs_cmd %02X\n", term.dcs_cmd);
             if (term.csi_argv[term.csi_argc])
               term.csi_argc ++;
+            term.stats.dcs++;
             do_dcs();
             term.state = DCS_PASSTHROUGH;
           when '\e':
@@ -6239,6 +6541,7 @@ static void
         switch (c) {
           when '@' ... '~':  /* DCS cmd final byte */
             term.dcs_cmd = term.dcs_cmd << 8 | c;
+            term.stats.dcs++;
             do_dcs();
             term.state = DCS_PASSTHROUGH;
           when '\e':
@@ -6258,12 +6561,37 @@ static void
           when '\e':
             term.state = DCS_ESCAPE;
             term.esc_mod = 0;
-          othwise:
-            if (!term_push_cmd(c)) {
-              do_dcs();
-              term.cmd_buf[0] = c;
-              term.cmd_len = 1;
+          othwise: {
+            // take string contents in bulk, up to ESC (or SUB/CAN)
+            uint end = pos;
+            if (!term.printing) {
+              char * esc = (char *)memchr(buf + pos, '\e', len - pos);
+              uint lim = esc ? esc - buf : len;
+              while (end < lim && buf[end] != 0x1A && buf[end] != 0x18)
+                end++;
             }
+            const char * s = buf + pos - 1;
+            uint n = end - pos + 1;
+            pos = end;
+
+            if (term.dcs_cmd == 'q') {
+              // stream DECSIXEL data directly into the parser
+              if (term.imgs.parser_state && !sixel_parse(s, n))
+                term.state = DCS_IGNORE;
+            }
+            else {
+              uint pushed;
+              while ((pushed = term_push_cmds(s, n)) < n) {
+                // buffer exhausted; pass on what we have
+                do_dcs();
+                term.cmd_len = 0;
+                if (term.state != DCS_PASSTHROUGH)
+                  break;
+                s += pushed;
+                n -= pushed;
+              }
+            }
+          }
         }
 
       when DCS_IGNORE:
@@ -6300,23 +6628,29 @@ static void
   if (term.ring_enabled && term.curs.y != oldy)
     term.ring_enabled = false;
 
-  if (cfg.ligatures_support > 1) {
-    // refresh ligature rendering in old cursor line
-    term_invalidate(0, oldy, term.cols - 1, oldy);
-  }
+  // Background tab: model only, display is rebuilt on activation
+  if (!term.background) {
+    if (cfg.ligatures_support > 1) {
+      // refresh ligature rendering in old cursor line
+      term_invalidate(0, oldy, term.cols - 1, oldy);
+    }
 
-  // Update search match highlighting
-  //term_schedule_search_partial_update();
-  term_schedule_search_update();
+    // Update search match highlighting
+    //term_schedule_search_partial_update();
+    term_schedule_search_update();
 
-  // Update screen
-  win_schedule_update();
+    // Update screen
+    win_schedule_update();
+  }
 
   // Print
   if (term.printing) {
     printer_write(term.printbuf, term.printbuf_pos);
     term.printbuf_pos = 0;
   }
+
+  if (fix_status)
+    term.stats.write_us += term_usec() - start_us;
 }
 
 /* Empty the input buffer */
@@ -71,6 +71,8 @@ extern void (term_update_cs)(struct term* term_p);
 extern int termchars_equal(termchar * a, termchar * b);
 extern int termchars_equal_override(termchar * a, termchar * b, uint bchr, cattr battr);
 extern int termattrs_equal_fg(cattr * a, cattr * b);
+extern uint termchar_sum(termchar * tc);
+extern unsigned long long line_hash(termline * line);
 
 extern void copy_termchar(termline * destline, int x, termchar * src);
 extern void move_termchar(termline * line, termchar * dest, termchar * src);
@@ -0,0 +1,229 @@
+// timers.c (part of FaTTY)
+// Licensed under the terms of the GNU General Public License v3 or later.
+
+extern "C" {
+
+#include "timers.h"
+
+/*
+   Hierarchical timer wheel: the first level has a slot per tick,
+   the second level a slot per round of the first level; its timers
+   are cascaded into the first level when their round comes up.
+   Timers beyond the second level are parked in its last slot and
+   cascaded again until they are due.
+ */
+#define TICK 8  // ms
+#define L0_BITS 8
+#define L0_SIZE (1 << L0_BITS)  // 256 ticks, 2 seconds
+#define L1_SIZE 64              // 64 rounds, 2 minutes
+#define HASH_SIZE 64
+
+typedef struct timer {
+  struct timer * next;
+  struct timer ** pprev;  // link pointing to this timer
+  struct timer * hnext;   // lookup chain
+  timer_cb cb;
+  void * data;
+  ulong tick;             // due tick
+} timer;
+
+static timer * wheel0[L0_SIZE];
+static timer * wheel1[L1_SIZE];
+static timer * lookup[HASH_SIZE];
+static timer * spare = 0;
+static ulong wheel_tick;  // last tick processed
+static uint pending = 0;
+static uint slack = 0;
+
+static timer **
+lookup_chain(timer_cb cb, void * data)
+{
+  return &lookup[(((size_t)data >> 4) ^ ((size_t)cb >> 2)) % HASH_SIZE];
+}
+
+static void
+wheel_insert(timer * t)
+{
+  timer ** slot;
+  if ((long)(t->tick - wheel_tick) < L0_SIZE)
+    slot = &wheel0[t->tick % L0_SIZE];
+  else if ((t->tick >> L0_BITS) - (wheel_tick >> L0_BITS) < L1_SIZE)
+    slot = &wheel1[(t->tick >> L0_BITS) % L1_SIZE];
+  else  // too far: park in the last round
+    slot = &wheel1[((wheel_tick >> L0_BITS) + L1_SIZE - 1) % L1_SIZE];
+
+  t->next = *slot;
+  if (t->next)
+    t->next->pprev = &t->next;
+  t->pprev = slot;
+  *slot = t;
+}
+
+static void
+wheel_unlink(timer * t)
+{
+  *t->pprev = t->next;
+  if (t->next)
+    t->next->pprev = t->pprev;
+}
+
+static void
+timer_remove(timer * t)
+{
+  wheel_unlink(t);
+  timer ** chain = lookup_chain(t->cb, t->data);
+  while (*chain != t)
+    chain = &(*chain)->hnext;
+  *chain = t->hnext;
+  t->next = spare;
+  spare = t;
+  pending--;
+}
+
+void
+timers_set(timer_cb cb, void * data, uint delay, ulong now)
+{
+  if (!pending)
+    wheel_tick = now / TICK;
+
+  timer ** chain = lookup_chain(cb, data);
+  timer * t = *chain;
+  while (t && (t->cb != cb || t->data != data))
+    t = t->hnext;
+  if (t)
+    wheel_unlink(t);
+  else {
+    if (spare) {
+      t = spare;
+      spare = t->next;
+    }
+    else if (!(t = std_new(timer)))
+      return;
+    t->cb = cb;
+    t->data = data;
+    t->hnext = *chain;
+    *chain = t;
+    pending++;
+  }
+
+  t->tick = (now + delay + TICK - 1) / TICK;
+  if ((long)(t->tick - wheel_tick) < 1)
+    t->tick = wheel_tick + 1;
+  wheel_insert(t);
+}
+
+void
+timers_cancel(timer_cb cb, void * data)
+{
+  for (timer * t = *lookup_chain(cb, data); t; t = t->hnext)
+    if (t->cb == cb && t->data == data) {
+      timer_remove(t);
+      return;
+    }
+}
+
+void
+timers_cancel_data(void * data)
+{
+  for (uint i = 0; i < HASH_SIZE; i++)
+    for (timer * t = lookup[i], * next; t; t = next) {
+      next = t->hnext;
+      if (t->data == data)
+        timer_remove(t);
+    }
+}
+
+void
+timers_set_slack(uint ms)
+{
+  slack = ms;
+}
+
+static int
+tick_delay(ulong tick, ulong now)
+{
+  long delay = tick * TICK - slack - now;
+  return delay > 0 ? delay : 0;
+}
+
+int
+timers_next(ulong now)
+{
+  if (!pending)
+    return -1;
+
+  for (ulong tick = wheel_tick + 1; tick <= wheel_tick + L0_SIZE; tick++) {
+    if (!(tick % L0_SIZE) && wheel1[(tick >> L0_BITS) % L1_SIZE])
+      return tick_delay(tick, now);
+    if (wheel0[tick % L0_SIZE])
+      return tick_delay(tick, now);
+  }
+  ulong round = (wheel_tick >> L0_BITS) + 1;
+  for (ulong r = round + 1; r <= round + L1_SIZE; r++)
+    if (wheel1[r % L1_SIZE])
+      return tick_delay(r << L0_BITS, now);
+  return -1;
+}
+
+void
+timers_run(ulong now)
+{
+  ulong target = (now + slack) / TICK;
+  while (pending && (long)(target - wheel_tick) > 0) {
+    wheel_tick++;
+    if (!(wheel_tick % L0_SIZE)) {
+      timer ** slot = &wheel1[(wheel_tick >> L0_BITS) % L1_SIZE];
+      timer * t = *slot;
+      *slot = 0;
+      while (t) {
+        timer * next = t->next;
+        wheel_insert(t);
+        t = next;
+      }
+    }
+
+    // callbacks may set timers, but not in this slot
+    timer ** slot = &wheel0[wheel_tick % L0_SIZE];
+    while (*slot) {
+      timer * t = *slot;
+      timer_cb cb = t->cb;
+      void * data = t->data;
+      timer_remove(t);
+      cb(data);
+    }
+  }
+}
+
+#ifdef TIMERS_TEST
+
+static ulong fired[4];
+
+static void
+test_cb(void * data)
+{
+  fired[(size_t)data] = wheel_tick * TICK;
+}
+
+int
+main()
+{
+  timers_set(test_cb, (void *)0, 500, 1000);
+  timers_set(test_cb, (void *)1, 300, 1000);
+  timers_set(test_cb, (void *)2, 5000, 1000);
+  timers_set(test_cb, (void *)3, 600000, 1000);
+  timers_set(test_cb, (void *)1, 200, 1000);
+  timers_cancel(test_cb, (void *)2);
+  for (ulong now = 1000; now < 700000; now += 7) {
+    int delay = timers_next(now);
+    if (delay > 7)
+      now += delay - 7;
+    timers_run(now);
+  }
+  printf("%lu %lu %lu %lu pending %u\n", fired[0], fired[1], fired[2], fired[3], pending);
+#define due(i, ms) (fired[i] >= ms && fired[i] < ms + TICK)
+  return !(due(0, 1500) && due(1, 1200) && !fired[2] && due(3, 601000) && !pending);
+}
+
+#endif
+
+}
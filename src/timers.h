@@ -0,0 +1,26 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include "std.h"
+
+/*
+   Timer wheel, multiplexing the timers of all tabs onto a single
+   platform timer; independent of Windows, times are given in ms
+   of a monotonic clock. A timer is identified by its callback and data;
+   setting it again reschedules it.
+ */
+
+typedef void (*timer_cb)(void *);
+
+extern void timers_set(timer_cb cb, void * data, uint delay, ulong now);
+extern void timers_cancel(timer_cb cb, void * data);
+extern void timers_cancel_data(void * data);
+
+// timers due within this slack (ms) are fired together
+extern void timers_set_slack(uint slack);
+// delay until the platform timer is needed next, -1 if no timer is pending
+extern int timers_next(ulong now);
+// fire all timers that are due (within the slack)
+extern void timers_run(ulong now);
+
+#endif
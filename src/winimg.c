@@ -32,6 +32,17 @@ static size_t const TEMPFILE_MAX_NUM = 16;
 // protection limit against exhaustion of resources (Windows handles)
 // if we'd create ~10000 "CompatibleDCs", handle handling will fail...
 static int cdc = 999;
+// part of it not to be taken by retained ReGIS renderings
+#define CDC_SIXEL_RESERVE 500
+
+// state that retained ReGIS renderings depend on (palette, configuration)
+static uint regis_gen = 0;
+
+void
+winimgs_regis_changed(void)
+{
+  regis_gen++;
+}
 
 // override suppression of repetitive image painting
 bool force_imgs = true;
@@ -244,6 +255,115 @@ strage_read(temp_strage_t *strage, unsigned char *p, size_t size)
 }
 
 
+// image data cache: identical images (e.g. icons or sparklines redrawn 
+// by dashboards or prompts) share their data and decoded GDI+ image, 
+// across all tabs; entries are addressed by a digest of the content 
+// and released with their last user
+
+#define dont_debug_img_cache
+
+#define IMGCACHE_BUCKETS 256
+// sixel pixels are only shared up to this size, 
+// larger sixel graphics are paged out to the tempfile individually
+#define IMGCACHE_SIXEL_MAX (256 * 1024)
+
+static imgcache * imgcache_tab[IMGCACHE_BUCKETS];
+static uint imgcache_hits = 0, imgcache_misses = 0, imgcache_num = 0;
+static ulong imgcache_bytes = 0;
+
+void
+winimg_cache_stats(uint * hits, uint * misses, uint * entries, ulong * bytes)
+{
+  *hits = imgcache_hits;
+  *misses = imgcache_misses;
+  *entries = imgcache_num;
+  *bytes = imgcache_bytes;
+}
+
+static unsigned long long
+imgcache_digest(unsigned char * data, uint size, int pw, int ph)
+{
+  unsigned long long h = 0xCBF29CE484222325ULL ^ size
+                         ^ (unsigned long long)pw << 32
+                         ^ (unsigned long long)ph << 48;
+  uint i = 0;
+  for (; i + 8 <= size; i += 8) {
+    unsigned long long w;
+    memcpy(&w, data + i, 8);
+    h = (h ^ w) * 0x100000001B3ULL;
+    h ^= h >> 29;
+  }
+  for (; i < size; i++)
+    h = (h ^ data[i]) * 0x100000001B3ULL;
+  return h;
+}
+
+static imgcache *
+imgcache_lookup(unsigned char * data, uint size, int pw, int ph, bool sixel,
+                unsigned long long * phash)
+{
+  unsigned long long hash = imgcache_digest(data, size, pw, ph);
+  *phash = hash;
+  for (imgcache * ic = imgcache_tab[hash % IMGCACHE_BUCKETS]; ic; ic = ic->next)
+    if (ic->hash == hash && ic->size == size && ic->sixel == sixel
+        && (!sixel || (ic->pixelwidth == pw && ic->pixelheight == ph))
+        && !memcmp(ic->data, data, size)
+       )
+      return ic;
+  return 0;
+}
+
+static imgcache *
+imgcache_new(unsigned char * data, uint size, int pw, int ph, bool sixel,
+             unsigned long long hash)
+{
+  imgcache * ic = (imgcache *)malloc(sizeof(imgcache));
+  if (!ic)
+    return 0;
+  ic->hash = hash;
+  ic->refs = 0;
+  ic->sixel = sixel;
+  ic->size = size;
+  ic->pixelwidth = pw;
+  ic->pixelheight = ph;
+  ic->data = data;
+  ic->stream = 0;
+  ic->gimg = 0;
+  ic->next = imgcache_tab[hash % IMGCACHE_BUCKETS];
+  imgcache_tab[hash % IMGCACHE_BUCKETS] = ic;
+  imgcache_num++;
+  imgcache_bytes += size;
+  return ic;
+}
+
+static void
+imgcache_release(imgcache * ic)
+{
+  if (--ic->refs > 0)
+    return;
+
+  imgcache ** pp = &imgcache_tab[ic->hash % IMGCACHE_BUCKETS];
+  while (*pp != ic)
+    pp = &(*pp)->next;
+  *pp = ic->next;
+  imgcache_num--;
+  imgcache_bytes -= ic->size;
+#ifdef debug_img_cache
+  printf("imgcache release %d bytes; %d entries %lu bytes, hits %u misses %u\n",
+         ic->size, imgcache_num, imgcache_bytes, imgcache_hits, imgcache_misses);
+#endif
+
+#if CYGWIN_VERSION_API_MINOR >= 74
+  if (ic->gimg)
+    GdipDisposeImage((GpImage *)ic->gimg);
+  if (ic->stream)
+    ((IStream *)ic->stream)->lpVtbl->Release((IStream *)ic->stream);
+#endif
+  free(ic->data);
+  free(ic);
+}
+
+
 #define dont_debug_img_list
 #define dont_debug_img_disp
 #define dont_debug_img_over
@@ -280,9 +400,24 @@ bool
   printf("winimg_new [%d]->%p l %d t %d w %d h %d\n", img->imgi, pixels, left, scrtop, width, height);
 #endif
 
+  // look up identical image data
+  imgcache * ic = 0;
+  unsigned long long hash = 0;
+  bool sixel = !len;
+  uint size = len ?: (uint)(pixelwidth * pixelheight * 4);
+  bool cacheable = (int)len > 0 || (sixel && size <= IMGCACHE_SIXEL_MAX);
+  if (cacheable)
+    ic = imgcache_lookup(pixels, size, sixel ? pixelwidth : 0, 
+                         sixel ? pixelheight : 0, sixel, &hash);
+  // natural image size, if determined
+  uint natwidth = 0, natheight = 0;
+
   img->pixels = pixels;
+  img->cache = 0;
   img->hdc = NULL;
   img->hbmp = NULL;
+  img->rpadwidth = img->rpadheight = 0;
+  img->rgen = 0;
   img->left = left;
   img->top = term.virtuallines + scrtop;
   img->width = width;
@@ -312,32 +447,41 @@ bool
     if (!pixelwidth || !pixelheight || preserveAR) {
       // determine pixelwidth and pixelheight from image
       uint pw, ph;
-      gdiplus_init();
-      GpStatus s;
+      if (ic && ic->pixelwidth) {
+        // known from identical image
+        pw = ic->pixelwidth;
+        ph = ic->pixelheight;
+      }
+      else {
+        gdiplus_init();
+        GpStatus s;
 
-      IStream * fs = pSHCreateMemStream(img->pixels, img->len);
-      s = fs ? Ok : GenericError;
-      gpcheck("create mem stream", s);
+        IStream * fs = pSHCreateMemStream(img->pixels, img->len);
+        s = fs ? Ok : GenericError;
+        gpcheck("create mem stream", s);
 
-      GpBitmap * gbm = 0;
-      s = GdipCreateBitmapFromStream(fs, &gbm);
-      gpcheck("bitmap from stream", s);
+        GpBitmap * gbm = 0;
+        s = GdipCreateBitmapFromStream(fs, &gbm);
+        gpcheck("bitmap from stream", s);
 
-      s = GdipGetImageWidth(gbm, &pw);
-      gpcheck("get width", s);
-      s = GdipGetImageHeight(gbm, &ph);
-      gpcheck("get height", s);
+        s = GdipGetImageWidth(gbm, &pw);
+        gpcheck("get width", s);
+        s = GdipGetImageHeight(gbm, &ph);
+        gpcheck("get height", s);
 
-      s = GdipDisposeImage(gbm);
-      gpcheck("dispose image", s);
+        s = GdipDisposeImage(gbm);
+        gpcheck("dispose image", s);
 
-      if (fs) {
-        // Release stream resources
-        fs->lpVtbl->Release(fs);
-      }
+        if (fs) {
+          // Release stream resources
+          fs->lpVtbl->Release(fs);
+        }
 
-      if (s != Ok)
-        return false;
+        if (s != Ok)
+          return false;
+      }
+      natwidth = pw;
+      natheight = ph;
 
       // cropping pre-adjustment
       if (crop_width > 0)
@@ -413,6 +557,31 @@ bool
   else  // Sixel graphics
     img->id = 0;
 
+  // share image data with identical images
+  if (ic) {
+    imgcache_hits++;
+    if (!ic->sixel && !ic->pixelwidth) {
+      ic->pixelwidth = natwidth;
+      ic->pixelheight = natheight;
+    }
+    free(pixels);
+  }
+  else if (cacheable) {
+    imgcache_misses++;
+    ic = imgcache_new(pixels, size, sixel ? pixelwidth : natwidth, 
+                      sixel ? pixelheight : natheight, sixel, hash);
+  }
+  if (ic) {
+    ic->refs++;
+    img->cache = ic;
+    img->pixels = ic->data;
+  }
+#ifdef debug_img_cache
+  printf("imgcache %s %d bytes; %d entries %lu bytes, hits %u misses %u\n",
+         !ic ? "skip" : ic->refs > 1 ? "hit" : "new", size,
+         imgcache_num, imgcache_bytes, imgcache_hits, imgcache_misses);
+#endif
+
   *ppimg = img;
 
   return true;
@@ -461,7 +630,8 @@ winimg_lazyinit(imglist *img)
       if (img->pixels) {
         CopyMemory(pixels, img->pixels, size);
         //printf("winimg_lazyinit free pixels [%d]->%p\n", img->imgi, img->pixels);
-        free(img->pixels);
+        if (!img->cache)
+          free(img->pixels);
       } else {
         // resume from hibernation
         assert(img->strage);
@@ -479,6 +649,16 @@ winimg_lazyinit(imglist *img)
 static void
 winimg_hibernate(imglist *img)
 {
+  // ReGIS graphics: drop retained rendering, it is redrawn when needed
+  if (img->len < 0 && img->hdc) {
+    cdc++;
+    DeleteDC((HDC)(img->hdc));
+    DeleteObject(img->hbmp);
+    img->hdc = NULL;
+    img->hbmp = NULL;
+    return;
+  }
+
   // non-sixel images are not paged out
   if (img->len)
     return;
@@ -486,6 +666,17 @@ winimg_hibernate(imglist *img)
   if (!img->hdc)
     return;
 
+  if (img->cache) {
+    // shared pixels are kept in the cache, no need to page them out
+    cdc++;
+    DeleteDC((HDC)(img->hdc));
+    DeleteObject(img->hbmp);
+    img->hdc = NULL;
+    img->hbmp = NULL;
+    img->pixels = img->cache->data;
+    return;
+  }
+
   temp_strage_t *strage = strage_create();
   //printf("winimg_hibernate [%d]->%p to %p\n", img->imgi, img->pixels, strage);
   if (!strage)
@@ -512,19 +703,30 @@ winimg_hibernate(imglist *img)
 void
 winimg_destroy(imglist *img)
 {
-  if (img->hdc) {
+  if (img->len < 0) {  // ReGIS: drop retained rendering
+    if (img->hdc) {
+      cdc++;
+      DeleteDC((HDC)(img->hdc));
+      DeleteObject(img->hbmp);
+    }
+    regis_free((regis_list *)img->pixels);
+  } else if (img->hdc) {
     cdc++;
 #ifdef debug_dc
   printf("release dc, capacity ->%d\n", cdc);
 #endif
     DeleteDC((HDC)(img->hdc));
     DeleteObject(img->hbmp);
+  } else if (img->cache) {
+    // shared data released below
   } else if (img->pixels) {
     //printf("winimg_destroy free pixels %p\n", img->pixels);
     free(img->pixels);
   } else {
     strage_destroy(img->strage);
   }
+  if (img->cache)
+    imgcache_release(img->cache);
   if (img->id)
     free(img->id);
   free(img);
@@ -563,6 +765,48 @@ void
   term.imgs.altlast = NULL;
 }
 
+// memory held by an image, not counting data shared in the image cache
+static ulong
+winimg_memory(imglist *img)
+{
+  if (img->len < 0)  // ReGIS: retained rendering
+    return img->hdc ? (ulong)img->rpadwidth * img->rpadheight * 4 : 0;
+  if (img->hdc)
+    return winimg_len(img);
+  if (img->cache || !img->pixels)  // shared, or paged out
+    return 0;
+  return winimg_len(img);
+}
+
+ulong
+(winimgs_memory)(struct term* term_p)
+{
+  TERM_VAR_REF(true)
+
+  ulong bytes = 0;
+  for (imglist * img = term.imgs.first; img; img = img->next)
+    bytes += winimg_memory(img);
+  for (imglist * img = term.imgs.altfirst; img; img = img->next)
+    bytes += winimg_memory(img);
+  return bytes;
+}
+
+// page out all images, e.g. of a background tab to save memory
+void
+(winimgs_hibernate)(struct term* term_p)
+{
+  TERM_VAR_REF(true)
+
+  for (imglist * img = term.imgs.first; img; img = img->next) {
+    winimg_hibernate(img);
+    img->x = -1;  // enforce repainting (and resuming) when visible
+  }
+  for (imglist * img = term.imgs.altfirst; img; img = img->next) {
+    winimg_hibernate(img);
+    img->x = -1;
+  }
+}
+
 #define draw_img(...) (draw_img)(term_p, ##__VA_ARGS__)
 static void
 (draw_img)(struct term* term_p, HDC dc, imglist * img)
@@ -574,14 +818,21 @@ static void
 
     GpStatus s;
 
-    IStream * fs = pSHCreateMemStream(img->pixels, img->len);
-    s = fs ? Ok : GenericError;
-    gpcheck("create mem stream", s);
+    // reuse image decoded already for identical image
+    imgcache * ic = img->cache;
+    IStream * fs = 0;
+    GpImage * gimg = ic ? (GpImage *)ic->gimg : 0;
+    bool retain = false;
+    if (!gimg) {
+      fs = pSHCreateMemStream(img->pixels, img->len);
+      s = fs ? Ok : GenericError;
+      gpcheck("create mem stream", s);
 
-    GpImage * gimg = 0;
-    if (s == Ok) {
-      s = GdipLoadImageFromStream(fs, &gimg);
-      gpcheck("load stream", s);
+      if (s == Ok) {
+        s = GdipLoadImageFromStream(fs, &gimg);
+        gpcheck("load stream", s);
+        retain = ic && s == Ok;
+      }
     }
 
     // position
@@ -660,12 +911,21 @@ static void
 
     s = GdipDeleteGraphics(gr);
     gpcheck("delete gr", s);
-    s = GdipDisposeImage(gimg);
-    gpcheck("dispose img", s);
+    if (retain) {
+      // keep decoded image (and its stream) with the shared data
+      ic->gimg = gimg;
+      ic->stream = fs;
+    }
+    else if (ic && ic->gimg)
+      ;  // retained already
+    else {
+      s = GdipDisposeImage(gimg);
+      gpcheck("dispose img", s);
 
-    if (fs) {
-      // Release stream resources
-      fs->lpVtbl->Release(fs);
+      if (fs) {
+        // Release stream resources
+        fs->lpVtbl->Release(fs);
+      }
     }
 #else
   (void)dc; (void)img;
@@ -923,8 +1183,6 @@ static bool previously_selected = false;
           printf("paint: display img\n");
 #endif
           if (img->len < 0) {  // Draw ReGIS graphics
-            // extract ReGIS DCS parameter
-            int regarg = -1 - img->len;
             // check initial rendering
             bool first_draw = img->attr & 1;
             img->attr &= ~1;
@@ -968,12 +1226,28 @@ static bool previously_selected = false;
             // set up ReGIS drawing area and background pad;
             // arrange double buffering to avoid flickering
             // - well, actually it turns out that this would not be needed,
-            // but we stay with the separate rendering DC anyway, see below
-            HDC rdc = CreateCompatibleDC(dc);
-            // set up drawing pad
-            HBITMAP hbm = CreateCompatibleBitmap(dc, padwidth, padheight);
-            (void)SelectObject(rdc, hbm);
+            // but we stay with the separate rendering DC anyway, see below;
+            // the rendering is retained with the image, so the ReGIS 
+            // display list is only drawn again if the pad size, 
+            // the palette or the configuration changes
+            HDC rdc = (HDC)img->hdc;
+            HBITMAP hbm = (HBITMAP)img->hbmp;
+            bool redraw = !rdc || img->rpadwidth != padwidth || img->rpadheight != padheight
+                          || img->rgen != regis_gen;
+            if (redraw) {
+              if (rdc) {
+                cdc++;
+                DeleteObject(hbm);
+                DeleteDC(rdc);
+                img->hdc = img->hbmp = 0;
+              }
+              rdc = CreateCompatibleDC(dc);
+              // set up drawing pad
+              hbm = CreateCompatibleBitmap(dc, padwidth, padheight);
+              (void)SelectObject(rdc, hbm);
+            }
 #else
+            bool redraw = true;
 #warning transform placement fails on GDI output (incl. ExtTextOut)
 #warning so text will not be placed properly
             // rendering directly to a common DC, 
@@ -992,6 +1266,7 @@ static bool previously_selected = false;
             }
 #endif
 
+           if (redraw) {
 #ifdef debug_regis
             // mark terminal drawing pad 
             // (drawing area rounded up to cell-size)
@@ -1024,19 +1299,33 @@ static bool previously_selected = false;
             //printf("pad %d/%d draw %d/%d\n", padwidth, padheight, rwidth, rheight);
 
             // scale while drawing
-            regis_draw(rdc, scale, rwidth, rheight, regarg, img->pixels, first_draw, flush);
+            regis_draw(rdc, scale, rwidth, rheight, (regis_list *)img->pixels, first_draw, flush);
 
 #ifdef zoom_transform
             if (coord_transformed2)
               SetWorldTransform(rdc, &old_xform2);
 #endif
+           }
 
 #ifdef regis_use_separate_dc
             // copy rendered graphics from the separate DC into the window DC
             StretchBlt(dc, xlft, grtop, padwidth, padheight,
                        rdc, 0, 0, padwidth, padheight, SRCCOPY);
-            DeleteObject(hbm);
-            DeleteDC(rdc);
+            if (!redraw)
+              ;  // retained already
+            else if (cdc > CDC_SIXEL_RESERVE) {
+              // retain rendering for repainting
+              cdc--;
+              img->hdc = rdc;
+              img->hbmp = hbm;
+              img->rpadwidth = padwidth;
+              img->rpadheight = padheight;
+              img->rgen = regis_gen;
+            }
+            else {
+              DeleteObject(hbm);
+              DeleteDC(rdc);
+            }
 #else
             // restore coordinate mapping of window DC
             if (coord_transformed1)
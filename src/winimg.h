@@ -12,10 +12,17 @@ extern bool (winimg_new)(struct term* term_p, imglist * * ppimg, char * id,
                        int attr);
 extern void winimg_destroy(imglist * img);
 extern void winimg_lazyinit(imglist * img);
+extern void winimg_cache_stats(uint * hits, uint * misses, uint * entries, ulong * bytes);
+// redraw ReGIS graphics after palette or configuration changes
+extern void winimgs_regis_changed(void);
 #define winimgs_paint(...) (winimgs_paint)(term_p, ##__VA_ARGS__)
 extern void (winimgs_paint)(struct term* term_p);
 #define winimgs_clear(...) (winimgs_clear)(term_p, ##__VA_ARGS__)
 extern void (winimgs_clear)(struct term* term_p);
+#define winimgs_memory(...) (winimgs_memory)(term_p, ##__VA_ARGS__)
+extern ulong (winimgs_memory)(struct term* term_p);
+#define winimgs_hibernate(...) (winimgs_hibernate)(term_p, ##__VA_ARGS__)
+extern void (winimgs_hibernate)(struct term* term_p);
 
 // override suppression of repetitive image painting
 extern bool force_imgs;
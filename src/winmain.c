@@ -36,6 +36,9 @@ const char * fatty_debug;
 #include "charset.h"
 #include "tek.h"
 #include "print.h"  // list_printers
+#include "phases.h"
+#include "record.h"
+#include "glyphrun.h"
 
 #include <CommCtrl.h>
 #include <Windows.h>
@@ -140,6 +143,8 @@ static bool report_moni = false;
 static bool report_fonts = false;
 static int dynfonts = 0;
 bool report_config = false;
+static string startup_report = 0;
+static bool replay_max_speed = false;
 bool report_child_pid = false;
 bool report_child_tty = false;
 static bool report_winpid = false;
@@ -4009,6 +4014,9 @@ static void
 (font_cs_reconfig)(struct term* term_p, bool font_changed)
 {
   //printf("font_cs_reconfig font_changed %d\n", font_changed);
+  // text run layout and ReGIS graphics also depend on options other than fonts
+  glyphrun_invalidate();
+  winimgs_regis_changed();
   if (font_changed) {
     win_init_fonts(cfg.font.size, true);
     if (tek_mode)
@@ -6980,6 +6988,10 @@ static char help[] =
   "  -B, --Border frame|void  Use thin/no window border\n"
   "  -R, --Report s|o      Report window position (short/long) after exit\n"
   "      --nopin           Make this instance not pinnable to taskbar\n"
+  "      --trace-startup FILE|-  Write timing of startup phases (JSON)\n"
+  "      --record FILE     Record terminal output and input with timing\n"
+  "      --replay FILE     Replay recorded output and report statistics\n"
+  "      --replay-max FILE  Replay at maximum speed\n"
   "  -D, --daemon          Start new instance with Windows shortcut key\n"
   "      --class CLASS     Set window class name (default: " APPNAME ")\n"
   "  -H, --help            Display help and exit\n"
@@ -7045,6 +7057,10 @@ opts[] = {
   {"nopin",      no_argument,       0, ''},  // short option not enabled
   {"store-taskbar-properties", no_argument, 0, ''},  // no short option
   {"trace",      required_argument, 0, ''},  // short option not enabled
+  {"trace-startup", required_argument, 0, ''},  // no short option
+  {"record",     required_argument, 0, ''},  // no short option
+  {"replay",     required_argument, 0, ''},  // no short option
+  {"replay-max", required_argument, 0, ''},  // no short option
   // further xterm-style convenience options, all without short option:
   {"fg",         required_argument, 0, OPT_FG},
   {"bg",         required_argument, 0, OPT_BG},
@@ -7067,6 +7083,8 @@ main(int argc, char *argv[])
   char* cmd;
   struct term *term_p = null;
 
+  phase_begin("startup");
+
   main_argv = argv;
   main_argc = argc;
   fatty_debug = getenv("FATTY_DEBUG") ?: "";
@@ -7099,8 +7117,12 @@ main(int argc, char *argv[])
     asform("/home/%s", getlogin());
   setenv("HOME", home, 1);
 
+  phase_begin("init_config");
   init_config();
+  phase_end();
+  phase_begin("cs_init");
   cs_init();
+  phase_end();
 
   // Set size and position defaults.
   STARTUPINFOW sui;
@@ -7168,6 +7190,7 @@ main(int argc, char *argv[])
 #endif
 
   // Load config files
+  phase_begin("config files");
   // try global config file
   load_config("/etc/fattyrc", true);
 #if CYGWIN_VERSION_API_MINOR >= 74
@@ -7195,6 +7218,7 @@ main(int argc, char *argv[])
     load_config(rc_file, 2);
     std_delete(rc_file);
   }
+  phase_end();
 
   char *tablist[32];
   char *tablist_title[32];
@@ -7239,6 +7263,7 @@ main(int argc, char *argv[])
     unsetenv("FATTY_SHORTCUT");
   }
 
+  phase_begin("command line");
   for (;;) {
     int opt = cfg.short_long_opts
       ? getopt_long_only(argc, argv, short_opts, opts, 0)
@@ -7517,10 +7542,20 @@ main(int argc, char *argv[])
         dup(tfd);
         close(tfd);
       }
+      when '': startup_report = optarg;
+      when '':
+        if (!record_open(optarg))
+          option_error(__(const_cast<char *>("Cannot open recording file '%s'")), optarg, errno);
+      when '' case_or '':
+        if (!replay_open(optarg))
+          option_error(__(const_cast<char *>("Cannot open recording file '%s'")), optarg, errno);
+        replaying = true;
+        replay_max_speed = opt == '';
       when 'P':
         set_arg_option("ConPTY", optarg);
     }
   }
+  phase_end();
   //printf("WSL <%ls>\n", wslname);
 
 #ifdef debug_wslwinpath
@@ -7566,7 +7601,9 @@ main(int argc, char *argv[])
     else
       printf("Failed to add font %ls\n", fn);
   };
+  phase_begin("add fonts");
   handle_file_resources(W("fonts/*"), add_font);
+  phase_end();
   //printf("Added %d fonts\n", dynfonts);
 
   if (report_fonts) {
@@ -7578,12 +7615,14 @@ main(int argc, char *argv[])
   }
 
   copy_config(const_cast<char *>("main after -o"), &file_cfg, &cfg);
+  phase_begin("theme");
   if (*cfg.colour_scheme)
     load_scheme(cfg.colour_scheme);
   else if (*cfg.dark_theme && is_win_dark_mode())
     load_theme(cfg.dark_theme);
   else if (*cfg.theme_file)
     load_theme(cfg.theme_file);
+  phase_end();
 
   if (!wdpresent) {  // shortcut start directory is empty
     WCHAR cd[MAX_PATH + 1];
@@ -7607,7 +7646,9 @@ main(int argc, char *argv[])
     }
   }
 
+  phase_begin("finish_config");
   finish_config();
+  phase_end();
 
   int term_rows = cfg.rows;
   int term_cols = cfg.cols;
@@ -8154,6 +8195,7 @@ main(int argc, char *argv[])
 
   // Create initial window.
 //  term.show_scrollbar = cfg.scrollbar;  // hotfix #597
+  phase_begin("create window");
   wnd = CreateWindowExW(cfg.scrollbar < 0 ? WS_EX_LEFTSCROLLBAR : 0,
                         wclass, wtitle,
                         window_style | (cfg.scrollbar ? WS_VSCROLL : 0),
@@ -8181,6 +8223,7 @@ main(int argc, char *argv[])
   TabCtrl_SetMinTabWidth(fatty_tab_wnd, 100);
   const auto brush = CreateSolidBrush(cfg.tab_bg_colour);
   SetClassLongPtrW(fatty_tab_wnd, GCLP_HBRBACKGROUND, (LONG_PTR)brush);
+  phase_end();
 
   // INT16 to handle multi-monitor negative coordinates properly
   INT16 sx = 0, sy = 0, sdx = 1, sdy = 1;
@@ -8208,6 +8251,7 @@ main(int argc, char *argv[])
 
   // Initialise the terminal.
 
+  phase_begin("tabs");
   if (current_tab_size == 0) {
     win_tab_init(home, cmd, argv, term_width, term_height, tablist_title[0]);
   }
@@ -8223,6 +8267,7 @@ main(int argc, char *argv[])
 
     win_tab_set_argv(argv);
   }
+  phase_end();
 
   term_p = win_active_terminal();
   TERM_VAR_REF(true)
@@ -8559,7 +8604,9 @@ main(int argc, char *argv[])
 
   // Initialise various other stuff.
   win_init_cursors();
+  phase_begin("win_init_menus");
   win_init_menus();
+  phase_end();
   win_update_transparency(cfg.transparency, cfg.opaque_when_focused);
 
 #ifdef debug_display_monitors_mockup
@@ -8840,6 +8887,7 @@ main(int argc, char *argv[])
   // This is now aligned with hiding other windows (if tabbed); 
   // also to reduce initial white flickering (#1284), 
   // we run an initial contents update before showing the window.
+  phase_begin("show window");
   win_paint();
   // Finally show the window.
   ShowWindow(wnd, show_cmd);
@@ -8850,6 +8898,13 @@ main(int argc, char *argv[])
   is_init = true;
   // tab management: secure transparency appearance by hiding other tabs
   win_set_tab_focus('I');  // hide other tabs
+  phase_end();
+
+  // closes the startup span; recording stops here
+  phases_report(startup_report);
+
+  if (replaying)
+    child_replay(replay_max_speed);
 
   // Message loop.
   do {
@@ -64,6 +64,8 @@ extern struct tabinfo * tabinfo;
 extern int ntabinfo;
 
 extern COLORREF colours[COLOUR_NUM];
+// to be called after modifying colours
+extern void win_colours_changed(void);
 extern colour brighten(colour c, colour against, bool monotone);
 
 extern LOGFONT lfont;
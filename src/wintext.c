@@ -19,6 +19,8 @@ extern "C" {
 #include "winimg.h"  // winimgs_paint
 #include "tek.h"
 #include "child.h"   // child_tty
+#include "phases.h"
+#include "glyphrun.h"
 
 #include <winnls.h>
 #include <usp10.h>  // Uniscribe
@@ -655,6 +657,9 @@ win_init_fontfamily(HDC dc, int findex)
 
   trace_resize(("--- init_fontfamily\n"));
 
+  // cached text run layouts refer to the previous fonts
+  glyphrun_invalidate();
+
   for (uint i = 0; i < FONT_BOLDITAL; i++) {
     if (ff->fonts[i] && ff->cpcache[i])
       std_delete(ff->cpcache[i]);
@@ -1077,6 +1082,7 @@ void
 win_init_fonts(int size, bool allfonts)
 {
   trace_resize(("--- init_fonts %d\n", size));
+  phase_begin("win_init_fonts");
 
   HDC dc = GetDC(wnd);
 
@@ -1128,6 +1134,7 @@ win_init_fonts(int size, bool allfonts)
   initinit = false;
 
   ReleaseDC(wnd, dc);
+  phase_end();
 }
 
 wstring
@@ -1448,7 +1455,7 @@ static void
   }
   wchar wstbuf[term.cols + 1];
 
-  wchar debug[22];
+  wchar debug[96];
   *debug = 0;
   if (cfg.status_debug) {
     wchar kblayout[KL_NAMELENGTH];
@@ -1464,6 +1471,19 @@ static void
       extern uint mods_debug;
       swprintf(&debug[wcslen(debug)], 9, W("%06X"), mods_debug);
     }
+    if (cfg.status_debug & 4) {
+      // memory of this tab and of all tabs
+      termmem mem;
+      ulong tab_bytes = term_memory(&mem);
+      swprintf(&debug[wcslen(debug)], 28, W(".%luK/%luK"),
+               tab_bytes >> 10, term_memory_all() >> 10);
+    }
+    if (cfg.status_debug & 8) {
+      // output parsed, paints, and time spent in both
+      swprintf(&debug[wcslen(debug)], 32, W(".%luK:%lup:%lums"),
+               term.stats.bytes >> 10, term.stats.paints,
+               (term.stats.write_us + term.stats.paint_us) / 1000);
+    }
     wcscat(debug, W("]"));
   }
 
@@ -3075,12 +3095,10 @@ rtf_bold_decolour(cattrflags attr, colour_i * pfgi, colour_i * pbgi)
 // The exception is bold which can be applied as colour and/or thickness,
 // so ATTR_BOLD bit will be turned off if further thickening should not happen.
 // Always returns true colour, except ACM_RTF* modes which only do the palette.
-cattr
-(apply_attr_colour)(struct term* term_p, cattr a, attr_colour_mode mode)
+#define resolve_attr_colour(...) (resolve_attr_colour)(term_p, ##__VA_ARGS__)
+static cattr
+(resolve_attr_colour)(struct term* term_p, cattr a, attr_colour_mode mode)
 {
-  if (cfg.old_bold)
-    return old_apply_attr_colour(a, mode);
-
   // indexed modifications
   bool do_reverse_i = mode & (ACM_RTF_PALETTE | ACM_RTF_GEN);
   bool do_bold_i = mode & (ACM_TERM | ACM_RTF_PALETTE | ACM_RTF_GEN | ACM_SIMPLE | ACM_VBELL_BG);
@@ -3168,6 +3186,212 @@ cattr
   return a;
 }
 
+/*
+   Resolved colours of indexed fg/bg colour pairs, per attributes 
+   and mode, as a direct-mapped table, so that runs in palette colours 
+   do not need to redo bold colouring, dimming and brightening.
+   Entries are invalidated by generation when the palette changes 
+   (win_colours_changed) or any other state they depend on.
+ */
+#define RESOLVED_SIZE 4096  // power of 2
+
+// attributes relevant for the true colour result
+#define RESOLVED_ATTRS (ATTR_BOLD | ATTR_DIM | ATTR_REVERSE | ATTR_INVISIBLE | TATTR_CLEAR)
+
+static struct {
+  uint key, gen;
+  colour fg, bg;
+  bool unbold;
+} resolved[RESOLVED_SIZE];
+static uint resolved_gen = 1;
+static uint colours_gen = 0;
+
+void
+win_colours_changed(void)
+{
+  colours_gen++;
+  winimgs_regis_changed();
+}
+
+// Applies attributes to the fg/bg colours and returns the new cattr,
+// see resolve_attr_colour; results for palette colours are looked up.
+cattr
+(apply_attr_colour)(struct term* term_p, cattr a, attr_colour_mode mode)
+{
+  TERM_VAR_REF(true)
+
+  if (cfg.old_bold)
+    return old_apply_attr_colour(a, mode);
+
+  colour_i fgi = (colour_i)((a.attr & ATTR_FGMASK) >> ATTR_FGSHIFT);
+  colour_i bgi = (colour_i)((a.attr & ATTR_BGMASK) >> ATTR_BGSHIFT);
+  // true colour and RTF palette handling are direct
+  if (fgi >= TRUE_COLOUR || bgi >= TRUE_COLOUR
+      || (mode & (ACM_RTF_PALETTE | ACM_RTF_GEN))
+     )
+    return resolve_attr_colour(a, mode);
+
+  // state the table depends on besides the palette
+  static struct term* state_term = 0;
+  static uint state_colours_gen = 0, state_flags = 0;
+  uint flags = term.rvideo | term.enable_bold_colour << 1
+             | term.enable_blink_colour << 2
+             | cfg.bold_as_colour << 3 | cfg.bold_as_font << 4;
+  if (term_p != state_term || colours_gen != state_colours_gen
+      || flags != state_flags
+     )
+  {
+    state_term = term_p;
+    state_colours_gen = colours_gen;
+    state_flags = flags;
+    resolved_gen++;
+  }
+
+  cattrflags attrs = a.attr & RESOLVED_ATTRS;
+  uint key = fgi | bgi << 9 | mode << 18
+           | !!(attrs & ATTR_BOLD) << 23 | !!(attrs & ATTR_DIM) << 24
+           | !!(attrs & ATTR_REVERSE) << 25 | !!(attrs & ATTR_INVISIBLE) << 26
+           | !!(attrs & TATTR_CLEAR) << 27;
+  uint slot = (key * 2654435761u) >> 20;  // Fibonacci hash, 12 bits
+  auto * r = &resolved[slot];
+  if (r->gen != resolved_gen || r->key != key) {
+    cattr ra = a;
+    ra.attr = attrs | (cattrflags)fgi << ATTR_FGSHIFT | (cattrflags)bgi << ATTR_BGSHIFT;
+    ra = resolve_attr_colour(ra, mode);
+    r->key = key;
+    r->gen = resolved_gen;
+    r->fg = ra.truefg;
+    r->bg = ra.truebg;
+    r->unbold = (attrs & ATTR_BOLD) && !(ra.attr & ATTR_BOLD);
+  }
+
+  a.attr &= ~(ATTR_FGMASK | ATTR_BGMASK);
+  if (r->unbold)
+    a.attr &= ~ATTR_BOLD;
+  a.attr |= TRUE_COLOUR << ATTR_FGSHIFT | TRUE_COLOUR << ATTR_BGSHIFT;
+  a.truefg = r->fg;
+  a.truebg = r->bg;
+  return a;
+}
+
+/*
+ * Layout of a text run for win_text: font selection and character advances,
+ * depending only on the key and font setup, so they can be cached 
+ * (glyphrun.c) and reused when the same run is painted again.
+ */
+#define RUN_NARROW_50 0x100  // narrowed to half width (TATTR_NARROW|TATTR_CLEAR)
+#define RUN_SELFDRAWN 0x200  // graphic characters drawn by us, no font glyphs
+#define RUN_DIM_FONT 0x400   // dim font, as determined before colour handling
+
+// attributes relevant for font selection
+#define RUN_ATTR_MASK (ATTR_BOLD | UNDER_MASK | ATTR_ULCOLOUR \
+                       | ATTR_ITALIC | ATTR_STRIKEOUT \
+                       | ATTR_SUBSCR | ATTR_SUPERSCR | TATTR_EXPAND \
+                       | TATTR_NARROW | TATTR_ZOOMFULL | TATTR_SINGLE \
+                       | TATTR_COMBINING)
+
+static void
+layout_run(const glyphrun_key * key, glyphrun * run)
+{
+  struct fontfam * ff = &fontfamilies[key->font];
+  cattrflags attr = key->attr;
+  ushort lattr = key->mode & LATTR_MODE;
+
+ /* Select proper font */
+  uint nfont;
+  switch (lattr) {
+    when LATTR_NORM: nfont = 0;
+    when LATTR_WIDE: nfont = FONT_WIDE;
+    othwise:       nfont = FONT_WIDE + FONT_HIGH;
+  }
+
+  if (key->mode & RUN_DIM_FONT)
+    nfont |= FONT_DIM;
+
+  int wscale = 100;
+
+  if (attr & TATTR_EXPAND) {
+    if (nfont & FONT_WIDE)
+      wscale = 200;
+    nfont |= FONT_WIDE;
+  }
+  else if (key->mode & RUN_NARROW_50)
+    wscale = 50;
+#ifndef narrow_via_font
+  else if ((attr & TATTR_NARROW) && !(attr & TATTR_ZOOMFULL)) {
+    wscale = cfg.char_narrowing;
+    if (wscale > 100)
+      wscale = 100;
+    if (wscale < 50)
+      wscale = 50;
+    nfont |= FONT_NARROW;
+  }
+#endif
+
+  if (ff->bold_mode == BOLD_FONT && (attr & ATTR_BOLD))
+    nfont |= FONT_BOLD;
+  if (ff->und_mode == UND_FONT && (attr & UNDER_MASK) == ATTR_UNDER
+      && !(attr & ATTR_ULCOLOUR)
+     )
+    nfont |= FONT_UNDERLINE;
+  if (attr & ATTR_ITALIC)
+    nfont |= FONT_ITALIC;
+  if (attr & ATTR_STRIKEOUT
+      && !cfg.underl_manual && cfg.underl_colour == (colour)-1
+      && !(attr & ATTR_ULCOLOUR)
+     )
+    nfont |= FONT_STRIKEOUT;
+  if (attr & TATTR_ZOOMFULL)
+    nfont |= FONT_ZOOMFULL;
+  if (attr & (ATTR_SUBSCR | ATTR_SUPERSCR))
+    nfont |= FONT_ZOOMSMALL;
+  if (attr & TATTR_SINGLE)
+    nfont |= FONT_ZOOMDOWN;
+  another_font(ff, nfont);
+
+  run->manual_underline = false;
+  if (!ff->fonts[nfont]) {
+    if (nfont & FONT_UNDERLINE)
+      run->manual_underline = true;
+    // Don't force manual bold, it could be bad news.
+    nfont &= ~(FONT_BOLD | FONT_UNDERLINE);
+  }
+#ifdef narrow_via_font
+  if ((nfont & (FONT_WIDE | FONT_NARROW)) == (FONT_WIDE | FONT_NARROW))
+    nfont &= ~(FONT_WIDE | FONT_NARROW);
+#endif
+
+  another_font(ff, nfont);
+  if (!ff->fonts[nfont])
+    nfont = FONT_NORMAL;
+
+  run->font = nfont;
+  run->wscale = wscale;
+
+ /* Array with offsets between neighbouring characters */
+  // self-drawn characters are output as single placeholders
+  bool selfdrawn = key->mode & RUN_SELFDRAWN;
+  const wchar * text = key->text;
+  int len = key->len;
+  int dx = (attr & TATTR_COMBINING) ? 0 : key->cell;
+  for (int i = 0; i < len; i++) {
+    if (!selfdrawn && is_high_surrogate(text[i]))
+      // This does not have the expected effect so we keep splitting up 
+      // non-BMP characters into single character chunks for now (term.c)
+      run->dx[i] = 0;
+    else
+      run->dx[i] = dx;
+  }
+
+ /* Character cells length */
+  run->ulen = 0;
+  for (int i = 0; i < len; i++) {
+    run->ulen++;
+    if (!selfdrawn && char1ulen(const_cast<wchar *>(&text[i])) == 2)
+      i++;  // skip low surrogate;
+  }
+}
+
 /*
  * Draw a line of text in the window, at given character
  * coordinates, in given attributes.
@@ -3181,6 +3405,8 @@ void
 {
   TERM_VAR_REF(true)
     
+  term.stats.texts++;
+
 #ifdef debug_wscale
   if (attr.attr & (TATTR_EXPAND | TATTR_NARROW | TATTR_WIDE))
     for (int i = 0; i < len; i++)
@@ -3343,77 +3569,26 @@ void
   }
 
  /* Now that attributes are (almost) sorted out, select proper font */
-  uint nfont;
-  switch (lattr) {
-    when LATTR_NORM: nfont = 0;
-    when LATTR_WIDE: nfont = FONT_WIDE;
-    othwise:       nfont = FONT_WIDE + FONT_HIGH;
-  }
-
-  if (dim_font)
-    nfont |= FONT_DIM;
-
-  int wscale = 100;
-
-  if (attr.attr & TATTR_EXPAND) {
-    if (nfont & FONT_WIDE)
-      wscale = 200;
-    nfont |= FONT_WIDE;
-  }
-  else if (wscale_narrow_50)
-    wscale = 50;
-#ifndef narrow_via_font
-  else if ((attr.attr & TATTR_NARROW) && !(attr.attr & TATTR_ZOOMFULL)) {
-    wscale = cfg.char_narrowing;
-    if (wscale > 100)
-      wscale = 100;
-    if (wscale < 50)
-      wscale = 50;
-    nfont |= FONT_NARROW;
-  }
-#endif
-
   bool do_special_underlay = false;
   if (cfg.bold_as_special && (attr.attr & ATTR_BOLD)) {
     do_special_underlay = true;
     attr.attr &= ~ATTR_BOLD;
   }
-  if (ff->bold_mode == BOLD_FONT && (attr.attr & ATTR_BOLD))
-    nfont |= FONT_BOLD;
-  if (ff->und_mode == UND_FONT && (attr.attr & UNDER_MASK) == ATTR_UNDER
-      && !(attr.attr & ATTR_ULCOLOUR)
-     )
-    nfont |= FONT_UNDERLINE;
-  if (attr.attr & ATTR_ITALIC)
-    nfont |= FONT_ITALIC;
-  if (attr.attr & ATTR_STRIKEOUT
-      && !cfg.underl_manual && cfg.underl_colour == (colour)-1
-      && !(attr.attr & ATTR_ULCOLOUR)
-     )
-    nfont |= FONT_STRIKEOUT;
-  if (attr.attr & TATTR_ZOOMFULL)
-    nfont |= FONT_ZOOMFULL;
-  if (attr.attr & (ATTR_SUBSCR | ATTR_SUPERSCR))
-    nfont |= FONT_ZOOMSMALL;
-  if (attr.attr & TATTR_SINGLE)
-    nfont |= FONT_ZOOMDOWN;
-  another_font(ff, nfont);
-
-  bool force_manual_underline = false;
-  if (!ff->fonts[nfont]) {
-    if (nfont & FONT_UNDERLINE)
-      force_manual_underline = true;
-    // Don't force manual bold, it could be bad news.
-    nfont &= ~(FONT_BOLD | FONT_UNDERLINE);
-  }
-#ifdef narrow_via_font
-  if ((nfont & (FONT_WIDE | FONT_NARROW)) == (FONT_WIDE | FONT_NARROW))
-    nfont &= ~(FONT_WIDE | FONT_NARROW);
-#endif
 
-  another_font(ff, nfont);
-  if (!ff->fonts[nfont])
-    nfont = FONT_NORMAL;
+  glyphrun_key runkey = {
+    font : (uint)findex,
+    mode : lattr | (wscale_narrow_50 ? RUN_NARROW_50 : 0)
+                 | (dim_font ? RUN_DIM_FONT : 0)
+                 | (boxpower || boxcoded || dectcs ? RUN_SELFDRAWN : 0),
+    cell : char_width,
+    attr : attr.attr & RUN_ATTR_MASK,
+    text : text,
+    len : len
+  };
+  const glyphrun * run = glyphrun_get(&runkey, layout_run);
+  uint nfont = run->font;
+  bool force_manual_underline = run->manual_underline;
+  int wscale = run->wscale;
 
 #if defined(debug_bold) && debug_bold > 1
   wchar t[len + 1]; wcsncpy(t, text, len); t[len] = 0;
@@ -3514,23 +3689,10 @@ void
 
  /* Array with offsets between neighbouring characters */
   int dxs[len];
-  int dx = combining ? 0 : char_width;
-  for (int i = 0; i < len; i++) {
-    if (is_high_surrogate(text[i]))
-      // This does not have the expected effect so we keep splitting up 
-      // non-BMP characters into single character chunks for now (term.c)
-      dxs[i] = 0;
-    else
-      dxs[i] = dx;
-  }
+  memcpy(dxs, run->dx, len * sizeof(int));
 
  /* Character cells length */
-  int ulen = 0;
-  for (int i = 0; i < len; i++) {
-    ulen++;
-    if (char1ulen(&text[i]) == 2)
-      i++;  // skip low surrogate;
-  }
+  int ulen = run->ulen;
 
  /* Painting box */
   int width = char_width * (combining ? 1 : ulen);
@@ -5770,8 +5932,10 @@ win_set_colour(colour_i i, colour c)
   }
 
   // Redraw everything.
-  if (changed_something)
+  if (changed_something) {
+    win_colours_changed();
     win_invalidate_all(false);
+  }
 }
 
 colour
@@ -5812,6 +5976,7 @@ win_reset_colours(void)
   }
 
   memcpy(&colours[16], xterm_colours, sizeof xterm_colours);
+  win_colours_changed();
 
   // Foreground, background, cursor
   win_set_colour(FG_COLOUR_I, cfg.fg_colour);
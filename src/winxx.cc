@@ -1,7 +1,5 @@
 #include <windows.h>
 #include <windowsx.h>
-#include <set>
-#include <tuple>
 #include <vector>
 #include <algorithm>
 #include <climits>
@@ -23,6 +21,7 @@
 extern "C" {
   #include "winpriv.h"
   #include "winsearch.h"
+  #include "timers.h"
 
   extern wchar * cs__mbstowcs(const char * s);
   extern void * load_library_func(string lib, string func);
@@ -30,14 +29,8 @@ extern "C" {
 
 #define lengthof(array) (sizeof(array) / sizeof(*(array)))
 
-using std::tuple;
-using std::get;
-
 typedef void (*CallbackFn)(void*);
-typedef tuple<CallbackFn, void*> Callback;
-typedef std::set<Callback> CallbackSet;
 
-static CallbackSet callbacks;
 static std::vector<Tab> tabs;
 static unsigned int active_tab = 0;
 static std::mutex term_mutex;
@@ -101,23 +94,39 @@ Tab& Tab::operator=(Tab&& t) {
 
 extern "C" {
 
+  // All timers are multiplexed onto one window timer by the timer wheel;
+  // it is only reset if it needs to fire earlier.
+  #define WHEEL_TIMER 1
+  static bool wheel_armed = false;
+  static ulong wheel_due;
+
+  static void arm_wheel_timer() {
+      ulong now = mtime();
+      int delay = timers_next(now);
+      if (delay < 0) {
+        if (wheel_armed)
+          KillTimer(wnd, WHEEL_TIMER);
+        wheel_armed = false;
+      }
+      else if (!wheel_armed || now + delay < wheel_due) {
+        SetTimer(wnd, WHEEL_TIMER, delay, NULL);
+        wheel_armed = true;
+        wheel_due = now + delay;
+      }
+  }
+
   void win_set_timer(CallbackFn cb, void* data, uint ticks) {
-      auto result = callbacks.insert(std::make_tuple(cb, data));
-      CallbackSet::iterator iter = result.first;
-      SetTimer(wnd, reinterpret_cast<UINT_PTR>(&*iter), ticks, NULL);
+      timers_set_slack(cfg.timer_slack);
+      timers_set(cb, data, ticks, mtime());
+      arm_wheel_timer();
   }
 
   void win_process_timer_message(WPARAM message) {
       term_mutex.lock();
-      void* pointer = reinterpret_cast<void*>(message);
-      auto callback = *reinterpret_cast<Callback*>(pointer);
       KillTimer(wnd, message);
-      if (callbacks.find(callback) != callbacks.end()) {
-        callbacks.erase(callback);
-
-        // call the callback
-        get<0>(callback)( get<1>(callback) );
-      }
+      wheel_armed = false;
+      timers_run(mtime());
+      arm_wheel_timer();
       term_mutex.unlock();
   }
 
@@ -164,6 +173,7 @@ extern "C" {
       SendMessage(fatty_tab_wnd, TCM_SETCURSEL, active_tab, 0);
       Tab* active = &tabs.at(active_tab);
       for (Tab& tab : tabs) {
+          (term_set_background)(tab.terminal.get(), &tab != active);
           (term_set_focus)(tab.terminal.get(), &tab == active, false);
       }
       active->info.attention = false;
@@ -226,6 +236,29 @@ extern "C" {
   static char* g_cmd;
   static char** g_argv;
 
+  // working directory of the child process, for a new tab
+  static char* tab_cwd(struct term* term_p) {
+      std::stringstream cwd_path;
+      cwd_path << "/proc/" << term_p->child->pid << "/cwd";
+      return realpath(cwd_path.str().c_str(), 0);
+  }
+
+  // refill the pool of ready children once tab creation has settled,
+  // for the next tab to be created by win_tab_create;
+  // one child per timer tick, to keep the window responsive
+  static void refill_tab_pool(void*) {
+      struct term* term_p = win_active_terminal();
+      if (!term_p) return;
+      char* cwd = tab_cwd(term_p);
+      struct winsize wsz{(unsigned short)term_p->rows, (unsigned short)term_p->cols,
+                         (unsigned short)(term_p->cols * cell_width),
+                         (unsigned short)(term_p->rows * cell_height)};
+      bool more = child_pool_refill(g_cmd, g_argv, cwd, &wsz);
+      free(cwd);
+      if (more)
+        win_set_timer(refill_tab_pool, 0, 100);
+  }
+
   static void newtab(
           unsigned short rows, unsigned short cols,
           unsigned short width, unsigned short height, const char* cwd, char* title) {
@@ -249,6 +282,8 @@ extern "C" {
       tab.chld->home = g_home;
       struct winsize wsz{rows, cols, width, height};
       (child_create)(tab.chld.get(), tab.terminal.get(), g_argv, &wsz, cwd);
+      if (cfg.tab_pool > 0)
+        win_set_timer(refill_tab_pool, 0, 500);
       wchar *ws = cs__mbstowcs(tie.pszText);
       (win_tab_set_title)(tab.terminal.get(), ws);
       free(ws);
@@ -269,9 +304,7 @@ extern "C" {
   }
 
   void (win_tab_create)(struct term* term_p) {
-      std::stringstream cwd_path;
-      cwd_path << "/proc/" << term_p->child->pid << "/cwd";
-      char* cwd = realpath(cwd_path.str().c_str(), 0);
+      char* cwd = tab_cwd(term_p);
       set_tab_bar_visibility(tabs.size() > 0);
       newtab(term_p->rows, term_p->cols, term_p->cols * cell_width, term_p->rows * cell_height, cwd, nullptr);
       free(cwd);
@@ -279,13 +312,7 @@ extern "C" {
   }
 
   void remove_callbacks(struct term* term_p) {
-      for (;;) {
-        auto cb = std::find_if(callbacks.begin(), callbacks.end(), [term_p](Callback x) {
-          return ((struct term *)(get<1>(x)) == term_p); });
-        if (cb == callbacks.end()) break;
-        KillTimer(wnd, reinterpret_cast<UINT_PTR>(&*cb));
-        callbacks.erase(cb);
-      }
+      timers_cancel_data(term_p);
   }
 
   void win_tab_delete(struct term* term_p) {
@@ -326,7 +353,7 @@ extern "C" {
       unsigned int new_active_tab = 0;
       for (;;) {
           std::vector<Tab>::iterator it = std::find_if(tabs.begin(), tabs.end(), [](Tab& x) {
-                  return x.chld->pid == 0; });
+                  return x.chld->pid == 0 && !replaying; });
           if (it == tabs.end()) break;
           invalidate = true;
           remove_callbacks((*it).terminal.get());